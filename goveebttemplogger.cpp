@@ -55,16 +55,21 @@
 
 #include <algorithm>
 #include <array>
+#include <atomic>
 #include <cerrno>       // errno
 #include <cassert>
 #include <cfloat>
+#include <charconv>
+#include <chrono>
 #include <climits>
+#include <condition_variable>
 #include <cmath>
 #include <csignal>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
 #include <ctime>
+#include <deque>
 #include <dbus/dbus.h> //  sudo apt install libdbus-1-dev
 #include <fcntl.h>      // open, O_NONBLOCK
 #include <filesystem>
@@ -76,6 +81,8 @@
 #include <linux/rfkill.h>
 #include <locale>
 #include <map>
+#include <memory>
+#include <mutex>
 #include <openssl/evp.h> // sudo apt install libssl-dev
 #include <openssl/provider.h>
 #include <netdb.h>
@@ -85,11 +92,20 @@
 #include <set>
 #include <sstream>
 #include <string>
+#include <string_view>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
 #include <sys/types.h>
+#include <sys/un.h>
+#include <thread>
+#include <tuple>
+#include <type_traits>
 #include <unistd.h> // For close()
 #include <utime.h>
 #include <vector>
+#include <zlib.h> // sudo apt install zlib1g-dev
 #ifdef _BLUEZ_HCI_
 #include <arpa/inet.h>
 #include <bluetooth/bluetooth.h> // apt install libbluetooth-dev
@@ -228,12 +244,33 @@ std::filesystem::path SVGDirectory;	// If this remains empty, SVG Files are not
 int SVGBattery(0); // 0x01 = Draw Battery line on daily, 0x02 = Draw Battery line on weekly, 0x04 = Draw Battery line on monthly, 0x08 = Draw Battery line on yearly
 int SVGMinMax(0); // 0x01 = Draw Temperature and Humiditiy Minimum and Maximum line on daily, 0x02 = on weekly, 0x04 = on monthly, 0x08 = on yearly
 bool SVGFahrenheit(true);
+// One way of drawing the graphs. The first is set by -c, -b and -x and has no name. Each -V adds another, written to files with its name before the graph type.
+struct SVGVariant
+{
+	std::string Name;
+	bool Fahrenheit = true;
+	int Battery = 0;	// graph types, the same as SVGBattery
+	int MinMax = 0;	// graph types, the same as SVGMinMax
+	std::size_t Width = 500;
+	std::size_t Height = 135;
+};
+std::vector<SVGVariant> SVGVariants;	// filled once the options have been read
 std::filesystem::path SVGTitleMapFilename;
 std::filesystem::path SVGIndexFilename;
+bool SVGGzip(false);	// If set, a gzip compressed copy of each SVG file and the index is written next to it (name.svg.gz) for web servers that send precompressed files
+bool JSONExport(false);	// If set, each device's graph data is also written as JSON (gvh-XXXXXXXXXXXX.json) for the viewer page to draw in the browser
+int SVGThreads(0);	// If more than zero, SVG files are drawn and written by this many worker threads instead of by the loop servicing Bluetooth
 int LogFileTime(60);
 int MinutesAverage(5);
 int DaysBetweenDataDownload(0);
 int MaxMinutesBetweenBluetoothAdvertisments(0);
+bool CompressLogs(false);	// If set, log files for months that have ended are compressed with gzip. Compressed logs are read transparently.
+int LogDurability(0);	// 0 = leave log writes to the page cache, 1 = fdatasync every log file written at the end of each write cycle, 2 = also sync the log directory when a log file is created
+int StagingMinutes(0);	// If more than zero, log data is held in memory for up to this many minutes and written in larger appends
+size_t StagingKiloBytes(256);	// When staging, whole blocks are written early if this much log data is held in memory
+std::filesystem::path QuerySocketPath;	// If set, the logger answers --mrtg queries on this Unix domain socket, and --mrtg asks it before reading the log files
+mode_t QuerySocketMode(0660);	// permissions of the query socket, which decide which local users may connect to it
+std::string HTTPListen;	// If set, [address:]port the logger serves SVG graphs from memory on over HTTP
 // The following details were taken from https://github.com/oetiker/mrtg
 const size_t DAY_COUNT(600);			/* 400 samples is 33.33 hours */
 const size_t WEEK_COUNT(600);			/* 400 samples is 8.33 days */
@@ -364,6 +401,64 @@ ThermometerType String2ThermometerType(const std::string Text)
 		rval = ThermometerType::RUUVI;
 	return(rval);
 }
+/////////////////////////////////////////////////////////////////////////////
+// Builds text in a string with std::to_chars, producing the same characters as an ostream in the "C" locale without the stream, sentry and locale lookups for every number.
+// A double is written like an ostream's default format (printf %g, six significant digits), and FormatFixed(value, precision) like std::fixed with std::setprecision.
+struct FormatFixed
+{
+	FormatFixed(const double TheValue, const int ThePrecision) : Value(TheValue), Precision(ThePrecision) { };
+	double Value;
+	int Precision;
+};
+class FormatBuffer {
+public:
+	FormatBuffer(const size_t Reserve = 0) { Text.reserve(Reserve); };
+	const std::string& str(void) const { return(Text); };
+	void clear(void) { Text.clear(); };
+	FormatBuffer& operator<<(const char c) { Text.push_back(c); return(*this); };
+	FormatBuffer& operator<<(const char* TheText) { Text.append(TheText); return(*this); };
+	FormatBuffer& operator<<(const std::string& TheText) { Text.append(TheText); return(*this); };
+	FormatBuffer& operator<<(const std::string_view TheText) { Text.append(TheText); return(*this); };
+	FormatBuffer& operator<<(const double Value);
+	FormatBuffer& operator<<(const FormatFixed& Value);
+	// Every integer type except the character types, which an ostream writes as characters
+	template <typename N> typename std::enable_if<std::is_integral<N>::value && !std::is_same<N, char>::value && !std::is_same<N, signed char>::value && !std::is_same<N, unsigned char>::value && !std::is_same<N, bool>::value, FormatBuffer&>::type operator<<(const N Value)
+	{
+		char buffer[24];
+		auto result = std::to_chars(buffer, buffer + sizeof(buffer), Value);
+		Text.append(buffer, result.ptr);
+		return(*this);
+	};
+private:
+	std::string Text;
+};
+FormatBuffer& FormatBuffer::operator<<(const double Value)
+{
+	char buffer[32];
+#ifdef __cpp_lib_to_chars
+	auto result = std::to_chars(buffer, buffer + sizeof(buffer), Value, std::chars_format::general, 6);
+	if (result.ec == std::errc())
+		Text.append(buffer, result.ptr);
+#else
+	// Before GCC 11 the standard library only has to_chars for integers
+	auto Length = snprintf(buffer, sizeof(buffer), "%g", Value);
+	Text.append(buffer, std::min(size_t(Length), sizeof(buffer) - 1));
+#endif // __cpp_lib_to_chars
+	return(*this);
+}
+FormatBuffer& FormatBuffer::operator<<(const FormatFixed& Value)
+{
+	char buffer[352];	// room for DBL_MAX written out in full
+#ifdef __cpp_lib_to_chars
+	auto result = std::to_chars(buffer, buffer + sizeof(buffer), Value.Value, std::chars_format::fixed, Value.Precision);
+	if (result.ec == std::errc())
+		Text.append(buffer, result.ptr);
+#else
+	auto Length = snprintf(buffer, sizeof(buffer), "%.*f", Value.Precision, Value.Value);
+	Text.append(buffer, std::min(size_t(Length), sizeof(buffer) - 1));
+#endif // __cpp_lib_to_chars
+	return(*this);
+}
 class  Govee_Temp {
 public:
 	time_t Time;
@@ -483,7 +578,7 @@ Govee_Temp::Govee_Temp(const std::string & data) // Read data from the Log File
 }
 std::string Govee_Temp::WriteTXT(const char seperator) const
 {
-	std::ostringstream ssValue;
+	FormatBuffer ssValue(128);
 	ssValue << timeToExcelDate(Time);
 	ssValue << seperator << Temperature[0];
 	ssValue << seperator << Humidity;
@@ -523,7 +618,7 @@ std::string Govee_Temp::WriteTXT(const char seperator) const
 }
 std::string Govee_Temp::WriteCache(void) const
 {
-	std::ostringstream ssValue;
+	FormatBuffer ssValue(128);
 	ssValue << Time;
 	for (auto a : Temperature)
 		ssValue << "\t" << a;
@@ -1196,7 +1291,7 @@ Ruuvi_Tag::Ruuvi_Tag(const std::string& data)
 }
 std::string Ruuvi_Tag::WriteTXT(const char seperator) const
 {
-	std::ostringstream ssValue;
+	FormatBuffer ssValue(128);
 	ssValue << timeToExcelDate(Time);
 	ssValue << seperator << Temperature;
 	ssValue << seperator << Humidity;
@@ -1230,7 +1325,7 @@ std::string Ruuvi_Tag::WriteConsole(void) const
 }
 std::string Ruuvi_Tag::WriteCache(void) const
 {
-	std::ostringstream ssValue;
+	FormatBuffer ssValue(128);
 	ssValue << Time;
 	ssValue << "\t" << Temperature;
 	ssValue << "\t" << TemperatureMin;
@@ -1400,8 +1495,278 @@ std::map<bdaddr_t, std::queue<Govee_Temp>> GoveeTemperatures;
 std::map<bdaddr_t, ThermometerType> GoveeThermometers;
 std::map<bdaddr_t, Govee_Temp> GoveeLastReading;
 std::map<bdaddr_t, std::queue<Ruuvi_Tag>> RuuviTags;
+std::map<bdaddr_t, Ruuvi_Tag> RuuviLastReading;
 std::map<bdaddr_t, Govee_Device> GoveeDevices;
 /////////////////////////////////////////////////////////////////////////////
+// Counters kept in memory for the metrics endpoint. None of this is written to disk.
+struct DeviceStatistics
+{
+	unsigned long long Readings = 0;	// readings decoded from advertisements since the logger started
+	time_t LastSeen = 0;	// most recent advertisement, with or without a reading
+	bool HasRSSI = false;
+	int RSSI = 0;	// signal strength of the most recent advertisement that reported it, in dBm
+};
+std::map<bdaddr_t, DeviceStatistics> DeviceStats;
+struct LoggerStatistics
+{
+	time_t Started = 0;
+	unsigned long long Advertisements = 0;	// HCI advertising reports and D-Bus property updates processed
+	unsigned long long LogLines = 0;	// lines added to the log files
+	unsigned long long CacheSnapshots = 0;
+	unsigned long long CacheJournalAppends = 0;
+	std::atomic<unsigned long long> SVGFiles{ 0 };	// graphs written to the SVG directory, also counted by the SVG worker threads
+	unsigned long long SVGRenders = 0;	// graphs rendered for HTTP requests
+	unsigned long long HTTPRequests = 0;
+	unsigned long long Queries = 0;	// --query-socket queries answered
+};
+LoggerStatistics LoggerStats;
+// Only devices that have sent a reading are tracked, so phones and other passing advertisers don't accumulate.
+void UpdateDeviceStatistics(const bdaddr_t& TheAddress, const time_t TimeNow, const bool bReading, const bool bRSSI, const int RSSI)
+{
+	LoggerStats.Advertisements++;
+	auto it = DeviceStats.find(TheAddress);
+	if (bReading && (it == DeviceStats.end()))
+		it = DeviceStats.insert(std::pair<bdaddr_t, DeviceStatistics>(TheAddress, DeviceStatistics())).first;
+	if (it != DeviceStats.end())
+	{
+		if (bReading)
+			it->second.Readings++;
+		it->second.LastSeen = TimeNow;
+		if (bRSSI)
+		{
+			it->second.HasRSSI = true;
+			it->second.RSSI = RSSI;
+		}
+	}
+}
+/////////////////////////////////////////////////////////////////////////////
+// Trace points record when each stage of handling readings starts and ends, into a fixed size ring in memory. SIGUSR2 writes the ring
+// as Chrome trace event JSON (load it in chrome://tracing or https://ui.perfetto.dev) so a stall in the main loops can be matched to the radio,
+// a decode, a file write or a download without running a profiler. Only built with -D_TRACE_. Otherwise the TRACE_ macros compile to nothing.
+#ifdef _TRACE_
+struct TraceEvent
+{
+	const char* Name;	// always a string literal
+	char Phase;			// 'B' begin, 'E' end, as in the trace event format
+	long long Microseconds;
+};
+const size_t TRACE_RING_SIZE(1 << 16);	// a power of two, so the index wraps with a mask
+TraceEvent TraceRing[TRACE_RING_SIZE];
+size_t TraceCount(0);	// events ever recorded. The ring holds the last TRACE_RING_SIZE of them.
+volatile bool bTraceDump = false;
+inline void TraceRecord(const char* Name, const char Phase)
+{
+	TraceEvent& Event(TraceRing[TraceCount++ & (TRACE_RING_SIZE - 1)]);
+	Event.Name = Name;
+	Event.Phase = Phase;
+	Event.Microseconds = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+class TraceScope {
+public:
+	TraceScope(const char* TheName) : Name(TheName) { TraceRecord(Name, 'B'); };
+	~TraceScope() { TraceRecord(Name, 'E'); };
+protected:
+	const char* Name;
+};
+void SignalHandlerSIGUSR2(int signal)
+{
+	bTraceDump = true;	// written by the main loop, since file writes aren't safe in a signal handler
+}
+// The oldest events may be ends without their beginnings, which the trace viewers ignore.
+void WriteTraceFile(void)
+{
+	std::ostringstream TraceFilename;
+	TraceFilename << "gvh-trace-" << getpid() << "-" << time(NULL) << ".json";
+	const std::filesystem::path TracePath(std::filesystem::temp_directory_path() / TraceFilename.str());
+	std::ofstream TraceFile(TracePath);
+	if (TraceFile.is_open())
+	{
+		const size_t First(TraceCount > TRACE_RING_SIZE ? TraceCount - TRACE_RING_SIZE : 0);
+		std::ostringstream ssTrace;
+		ssTrace << "{\"traceEvents\":[";
+		for (auto index = First; index < TraceCount; index++)
+		{
+			const TraceEvent& Event(TraceRing[index & (TRACE_RING_SIZE - 1)]);
+			if (index != First)
+				ssTrace << ",";
+			ssTrace << "\n{\"name\":\"" << Event.Name << "\",\"ph\":\"" << Event.Phase << "\",\"ts\":" << Event.Microseconds << ",\"pid\":" << getpid() << ",\"tid\":1}";
+		}
+		ssTrace << "\n],\"displayTimeUnit\":\"ms\"}\n";
+		TraceFile << ssTrace.str();
+		TraceFile.close();
+		if (ConsoleVerbosity > 0)
+			std::cout << "[" << getTimeISO8601(true) << "] Writing: " << TracePath.string() << " (" << TraceCount - First << " events)" << std::endl;
+		else
+			std::cerr << "Writing: " << TracePath.string() << " (" << TraceCount - First << " events)" << std::endl;
+	}
+	else
+		std::cerr << "Error: Unable to write " << TracePath.string() << std::endl;
+}
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_BEGIN(name) TraceRecord(name, 'B')
+#define TRACE_END(name) TraceRecord(name, 'E')
+#define TRACE_SCOPE(name) TraceScope TRACE_CONCAT(TraceScope_, __LINE__)(name)
+#else
+#define TRACE_BEGIN(name)
+#define TRACE_END(name)
+#define TRACE_SCOPE(name)
+#endif // _TRACE_
+/////////////////////////////////////////////////////////////////////////////
+// Timing of the work done between advertisements, printed on SIGUSR1 and optionally every few minutes so the next bottleneck can be found from data.
+// Everything but SVGRender is only touched by the main thread, so plain counters are enough. The SVG worker threads add to SVGRender under PerfStatsMutex.
+class PerfHistogram {
+public:
+	PerfHistogram() : Count(0), Total(0), Max(0), Bytes(0), Buckets{ 0 } { };
+	void Add(const std::chrono::steady_clock::time_point& Start, const size_t TheBytes = 0);
+	unsigned long long Percentile(const double Fraction) const;	// upper bound of the bucket, in microseconds
+	std::string WriteConsole(void) const;
+	unsigned long long GetCount(void) const { return(Count); };
+protected:
+	unsigned long long Count;
+	unsigned long long Total;	// microseconds
+	unsigned long long Max;		// microseconds
+	unsigned long long Bytes;
+	unsigned long long Buckets[40];	// Buckets[n] counts durations under 2^n microseconds that didn't fit in Buckets[n-1]
+};
+void PerfHistogram::Add(const std::chrono::steady_clock::time_point& Start, const size_t TheBytes)
+{
+	const unsigned long long Duration(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - Start).count());
+	size_t Bucket = 0;
+	while ((Bucket < (sizeof(Buckets) / sizeof(Buckets[0])) - 1) && ((1ULL << Bucket) <= Duration))
+		Bucket++;
+	Buckets[Bucket]++;
+	Count++;
+	Total += Duration;
+	Max = std::max(Max, Duration);
+	Bytes += TheBytes;
+}
+unsigned long long PerfHistogram::Percentile(const double Fraction) const
+{
+	unsigned long long rval = 0;
+	unsigned long long Cumulative = 0;
+	for (size_t Bucket = 0; (Bucket < sizeof(Buckets) / sizeof(Buckets[0])) && (Cumulative < Fraction * Count); Bucket++)
+	{
+		Cumulative += Buckets[Bucket];
+		rval = 1ULL << Bucket;
+	}
+	return(rval);
+}
+std::string PerfHistogram::WriteConsole(void) const
+{
+	std::ostringstream ssValue;
+	ssValue << "n=" << Count;
+	if (Count > 0)
+	{
+		ssValue << " avg=" << Total / Count << "us";
+		ssValue << " p50<" << Percentile(0.5) << "us";
+		ssValue << " p99<" << Percentile(0.99) << "us";
+		ssValue << " max=" << Max << "us";
+		if (Bytes > 0)
+			ssValue << " bytes=" << Bytes;
+	}
+	return(ssValue.str());
+}
+struct PerfStatistics
+{
+	unsigned long long HCIAdvertisements = 0;
+	unsigned long long DBusAdvertisements = 0;	// device property updates, from InterfacesAdded and PropertiesChanged
+	std::map<std::string, unsigned long long> DBusMembers;	// D-Bus signals received, by member name
+	std::map<ThermometerType, unsigned long long> Decoded;
+	std::map<ThermometerType, unsigned long long> DecodeFailed;
+	PerfHistogram UpdateMRTG;
+	PerfHistogram LogFlush;		// one write of staged log data to one log file
+	PerfHistogram CacheFlush;	// one cache snapshot or journal append
+	PerfHistogram DeviceSVG;	// the four graphs of one device, or with --svg-threads only copying and queueing the ones that changed
+	PerfHistogram SVGRender;	// with --svg-threads, one graph in every variant or one JSON export drawn and written by a worker
+};
+PerfStatistics PerfStats;
+std::mutex PerfStatsMutex;
+int PerfStatsMinutes(0);	// If more than zero, a line of performance statistics is printed this often
+volatile bool bPerfDump = false;
+void SignalHandlerSIGUSR1(int signal)
+{
+	bPerfDump = true;	// printed by the main loop, since printing isn't safe in a signal handler
+}
+// Counts readings decoded by model. A failure is only counted for a device already known to be a thermometer,
+// since manufacturer data from every other advertiser fails to decode too. Some models also send iBeacon advertisements, which are counted as failures.
+void CountDecode(const ThermometerType Model, const bool bDecoded)
+{
+	if (bDecoded)
+		PerfStats.Decoded[Model]++;
+	else if (Model != ThermometerType::Unknown)
+		PerfStats.DecodeFailed[Model]++;
+}
+void WritePerfStatistics(const bool bDetailed)
+{
+	PerfHistogram SVGRender;
+	{
+		std::lock_guard<std::mutex> Lock(PerfStatsMutex);
+		SVGRender = PerfStats.SVGRender;
+	}
+	std::ostringstream ssOutput;
+	unsigned long long Decoded = 0;
+	unsigned long long DecodeFailed = 0;
+	for (auto const& [Model, Count] : PerfStats.Decoded)
+		Decoded += Count;
+	for (auto const& [Model, Count] : PerfStats.DecodeFailed)
+		DecodeFailed += Count;
+	if (ConsoleVerbosity > 0)
+		ssOutput << "[" << getTimeISO8601(true) << "] ";
+	ssOutput << "Stats: advertisements HCI " << PerfStats.HCIAdvertisements << " D-Bus " << PerfStats.DBusAdvertisements;
+	ssOutput << ", decoded " << Decoded << " failed " << DecodeFailed;
+	ssOutput << ", MRTG " << PerfStats.UpdateMRTG.WriteConsole();
+	ssOutput << ", log " << PerfStats.LogFlush.WriteConsole();
+	ssOutput << ", cache " << PerfStats.CacheFlush.WriteConsole();
+	ssOutput << ", SVG " << PerfStats.DeviceSVG.WriteConsole();
+	if (SVGRender.GetCount() > 0)
+		ssOutput << ", SVG workers " << SVGRender.WriteConsole();
+	if (bDetailed)
+	{
+		for (auto const& [Model, Count] : PerfStats.Decoded)
+			ssOutput << std::endl << "[                   ] decoded " << ThermometerType2String(Model) << ": " << Count;
+		for (auto const& [Model, Count] : PerfStats.DecodeFailed)
+			ssOutput << std::endl << "[                   ] failed to decode " << ThermometerType2String(Model) << ": " << Count;
+		for (auto const& [Member, Count] : PerfStats.DBusMembers)
+			ssOutput << std::endl << "[                   ] D-Bus " << Member << ": " << Count;
+		ssOutput << std::endl << "[                   ] UpdateMRTGData: " << PerfStats.UpdateMRTG.WriteConsole();
+		ssOutput << std::endl << "[                   ] log file write: " << PerfStats.LogFlush.WriteConsole();
+		ssOutput << std::endl << "[                   ] cache file write: " << PerfStats.CacheFlush.WriteConsole();
+		ssOutput << std::endl << "[                   ] SVG files of a device: " << PerfStats.DeviceSVG.WriteConsole();
+		ssOutput << std::endl << "[                   ] SVG worker job: " << SVGRender.WriteConsole();
+	}
+	if (ConsoleVerbosity > 0)
+		std::cout << ssOutput.str() << std::endl;
+	else
+		std::cerr << ssOutput.str() << std::endl;
+}
+// Called from each main loop. Prints everything after SIGUSR1, and the summary line when it's due. Writes the trace file after SIGUSR2.
+void ReportPerfStatistics(void)
+{
+#ifdef _TRACE_
+	if (bTraceDump)
+	{
+		bTraceDump = false;
+		WriteTraceFile();
+	}
+#endif // _TRACE_
+	static time_t LastReport = 0;
+	time_t TimeNow;
+	time(&TimeNow);
+	if (LastReport == 0)
+		LastReport = TimeNow;
+	if (bPerfDump)
+	{
+		bPerfDump = false;
+		WritePerfStatistics(true);
+	}
+	else if ((PerfStatsMinutes > 0) && (difftime(TimeNow, LastReport) >= PerfStatsMinutes * 60))
+	{
+		LastReport = TimeNow;
+		WritePerfStatistics(false);
+	}
+}
+/////////////////////////////////////////////////////////////////////////////
 volatile bool bRun = true; // This is declared volatile so that the compiler won't optimized it out of loops later in the code
 void SignalHandlerSIGINT(int signal)
 {
@@ -1546,26 +1911,34 @@ void GeneratePersistenceFile(std::map<bdaddr_t, ThermometerType> & ThermometerTy
 		if (NewData)
 #endif // LIMIT_WRITES_TO_PERSISTENCE_DATA_FILE
 		{
-			std::ofstream PersistenceFile(filename, std::ios_base::out | std::ios_base::trunc);
-			if (PersistenceFile.is_open())
+			std::ostringstream PersistenceData;
+			for (auto const& [TheAddress, TheType] : ThermometerTypes)
 			{
-				for (auto const& [TheAddress, TheType] : ThermometerTypes)
+				PersistenceData << ba2string(TheAddress) << "\t" << ThermometerType2String(TheType);
+				if (auto search = GoveeDevices.find(TheAddress); search != GoveeDevices.end())
 				{
-					PersistenceFile << ba2string(TheAddress) << "\t" << ThermometerType2String(TheType);
-					if (auto search = GoveeDevices.find(TheAddress); search != GoveeDevices.end())
-					{
-						if (0 != search->second.GetLastDownload())
-							PersistenceFile << "\t" << timeToISO8601(search->second.GetLastDownload());
-						if (!search->second.GetHardwareVersion().empty())
-							PersistenceFile << "\tHW:" << search->second.GetHardwareVersion();
-						if (!search->second.GetFirmwareVersion().empty())
-							PersistenceFile << "\tFW:" << search->second.GetFirmwareVersion();
-						if (search->second.GetSerialNumber() != 0)
-							PersistenceFile << "\tSN:" << std::dec << search->second.GetSerialNumber();
-					}
-					PersistenceFile << std::endl;
+					if (0 != search->second.GetLastDownload())
+						PersistenceData << "\t" << timeToISO8601(search->second.GetLastDownload());
+					if (!search->second.GetHardwareVersion().empty())
+						PersistenceData << "\tHW:" << search->second.GetHardwareVersion();
+					if (!search->second.GetFirmwareVersion().empty())
+						PersistenceData << "\tFW:" << search->second.GetFirmwareVersion();
+					if (search->second.GetSerialNumber() != 0)
+						PersistenceData << "\tSN:" << std::dec << search->second.GetSerialNumber();
 				}
+				PersistenceData << std::endl;
+			}
+			// This is called every write cycle but the contents rarely change, so don't rewrite the file if it still holds what we last wrote.
+			static std::string LastPersistenceData;
+			struct stat64 PersistenceStat({ 0 });
+			std::ofstream PersistenceFile;
+			if ((PersistenceData.str() != LastPersistenceData) || (0 != stat64(filename.c_str(), &PersistenceStat)) || (PersistenceStat.st_size != off_t(LastPersistenceData.size())))
+				PersistenceFile.open(filename, std::ios_base::out | std::ios_base::trunc);
+			if (PersistenceFile.is_open())
+			{
+				PersistenceFile << PersistenceData.str();
 				PersistenceFile.close();
+				LastPersistenceData = PersistenceData.str();
 				struct utimbuf Persistut({ 0 });
 				Persistut.actime = MostRecentDownload;
 				Persistut.modtime = MostRecentDownload;
@@ -1710,274 +2083,1068 @@ void ReadPersistenceFile(std::map<bdaddr_t, ThermometerType>& ThermometerTypes,
 		}
 	}
 }
-template <typename T> bool GenerateLogFile(std::map<bdaddr_t, std::queue<T>> &AddressTemperatureMap)
+/////////////////////////////////////////////////////////////////////////////
+// Each monthly log file has a small sidecar index (gvh-XXXXXXXXXXXX-YYYY-MM.idx) with one line per hour holding the time of the hour and the byte offset of the first line logged in that hour.
+// Entries are only added for data appended in time order, so older data appended by a download can still only be found by scanning the log file.
+// The index is only used to reload a monitored log file from the hour of the newest data in memory. --mrtg lookups read the log backwards from its end and don't need it.
+const time_t LOG_INDEX_BUCKET(60 * 60);	/* one index entry per hour */
+std::map<std::filesystem::path, time_t> LogIndexLastBucket; // newest hour indexed for each log file this process has written
+std::filesystem::path GenerateLogIndexFileName(const std::filesystem::path& LogFileName)
+{
+	std::filesystem::path IndexFileName(LogFileName);
+	IndexFileName.replace_extension(".idx");
+	return(IndexFileName);
+}
+// Reads the sidecar index of a log file. Returns false if there is no index or if the last entry doesn't point at the start of a line in the indexed hour, which happens if the log was rewritten without the index.
+bool ReadLogIndex(const std::filesystem::path& LogFileName, std::map<time_t, off_t>& TheIndex)
 {
 	bool rval = false;
-	if (!LogDirectory.empty())
+	TheIndex.clear();
+	std::ifstream IndexFile(GenerateLogIndexFileName(LogFileName));
+	if (IndexFile.is_open())
 	{
-		if (ConsoleVerbosity > 1)
-			std::cout << "[" << getTimeISO8601(true) << "] GenerateLogFile: " << LogDirectory.native() << std::endl;
-		for (auto& [TheAddress, LogData] : AddressTemperatureMap)
+		std::string TheLine;
+		std::string LastHour;
+		while (std::getline(IndexFile, TheLine))
 		{
-			if (!LogData.empty()) // Only open the log file if there are entries to add
+			auto Tab = TheLine.find('\t');
+			if ((Tab != std::string::npos) && (Tab >= 13))
 			{
-				std::filesystem::path filename(GenerateLogFileName(TheAddress, LogData.front().GetModel()));
-				std::ofstream LogFile(filename, std::ios_base::out | std::ios_base::app | std::ios_base::ate);
-				if (LogFile.is_open())
+				try
 				{
-					time_t MostRecentData(0);
-					while (!LogData.empty())
-					{
-						LogFile << LogData.front().WriteTXT() << std::endl;
-						MostRecentData = std::max(LogData.front().Time, MostRecentData);
-						LogData.pop();
-					}
-					LogFile.close();
-					struct utimbuf Log_ut({ 0 });
-					Log_ut.actime = MostRecentData;
-					Log_ut.modtime = MostRecentData;
-					utime(filename.c_str(), &Log_ut);
-					rval = true;
-					if (ConsoleVerbosity > 1)
-						std::cout << "[" << getTimeISO8601(true) << "] Writing: " << filename.native() << std::endl;
+					TheIndex.insert_or_assign(ISO8601totime(TheLine.substr(0, Tab)), off_t(std::stoll(TheLine.substr(Tab + 1))));
+					LastHour = TheLine.substr(0, 13); // "YYYY-MM-DD HH"
 				}
+				catch (const std::exception& e) { TheIndex.clear(); break; }
 			}
 		}
-	}
-	else
-	{
-		// clear the queued data if LogDirectory not specified
-		for (auto& [TheAddress, LogData] : AddressTemperatureMap)
-			while (!LogData.empty())
-				LogData.pop();
+		IndexFile.close();
+		if (!TheIndex.empty())
+		{
+			int TheFile = open(LogFileName.c_str(), O_RDONLY);
+			if (TheFile >= 0)
+			{
+				char Buffer[13];
+				if (sizeof(Buffer) == pread(TheFile, Buffer, sizeof(Buffer), TheIndex.rbegin()->second))
+					rval = (0 == LastHour.compare(0, LastHour.size(), Buffer, sizeof(Buffer)));
+				close(TheFile);
+			}
+		}
+		if (!rval)
+			TheIndex.clear();
 	}
 	return(rval);
 }
-bool GetLogEntry(const bdaddr_t &InAddress, const int Minutes, Govee_Temp & OutValue)
+// Scans a whole log file and writes its sidecar index from scratch. Returns the newest hour indexed.
+time_t BuildLogIndex(const std::filesystem::path& LogFileName)
 {
-	// Returned value is now the average of whatever values were recorded over the previous 5 minutes
-	bool rval = false;
-	std::ifstream TheFile(GenerateLogFileName(InAddress));
-	if (TheFile.is_open())
+	time_t LastBucket(0);
+	std::ifstream TheFile(LogFileName);
+	std::ofstream IndexFile(GenerateLogIndexFileName(LogFileName), std::ios_base::out | std::ios_base::trunc);
+	if (TheFile.is_open() && IndexFile.is_open())
 	{
-		time_t now = ISO8601totime(getTimeISO8601());
-		std::queue<Govee_Temp> LogValues;
-
-		TheFile.seekg(0, std::ios_base::end);      //Start at end of file
-		do
+		if (ConsoleVerbosity > 1)
+			std::cout << "[" << getTimeISO8601(true) << "] Indexing: " << LogFileName.native() << std::endl;
+		off_t Offset(0);
+		std::string TheLine;
+		while (std::getline(TheFile, TheLine))
 		{
-			char ch = ' ';                             //Init ch not equal to '\n'
-			while (ch != '\n')
+			if ((TheLine.size() >= 19) && std::isdigit(TheLine[0]))
 			{
-				TheFile.seekg(-2, std::ios_base::cur); //Two steps back, this means we will NOT check the last character
-				if ((int)TheFile.tellg() <= 0)         //If passed the start of the file,
+				time_t Bucket = (ISO8601totime(TheLine) / LOG_INDEX_BUCKET) * LOG_INDEX_BUCKET;
+				if (Bucket > LastBucket)
 				{
-					TheFile.seekg(0);                  //this is the start of the line
-					break;
+					IndexFile << timeToExcelDate(Bucket) << "\t" << Offset << "\n";
+					LastBucket = Bucket;
 				}
-				TheFile.get(ch);                       //Check the next character
 			}
-			auto FileStreamPos = TheFile.tellg(); // Save Current Stream Position
-			std::string TheLine;
-			std::getline(TheFile, TheLine);
-			TheFile.seekg(FileStreamPos);	// Move Stream position to where it was before reading TheLine
-
-			char buffer[256];
-			if (TheLine.size() < sizeof(buffer))
-			{
-				TheLine.copy(buffer, TheLine.size());
-				buffer[TheLine.size()] = '\0';
-				std::string theDate(strtok(buffer, "\t"));
-				std::string theTemp(strtok(NULL, "\t"));
-				std::string theHumidity(strtok(NULL, "\t"));
-				std::string theBattery(strtok(NULL, "\t"));
-				Govee_Temp TheValue(ISO8601totime(theDate), atof(theTemp.c_str()), atof(theHumidity.c_str()), atoi(theBattery.c_str()));
-				if ((Minutes == 0) && LogValues.empty()) // HACK: Special Case to always accept the last logged value
-					LogValues.push(TheValue);
-				if ((Minutes * 60.0) < difftime(now, TheValue.Time))	// If this entry is more than Minutes parameter from current time, it's time to stop reading log file.
-					break;
-				LogValues.push(TheValue);
-			}
-		} while (TheFile.tellg() > 0);	// If we are at the beginning of the file, there's nothing more to do
-		TheFile.close();
-		if (!LogValues.empty())
-			OutValue = Govee_Temp();
-		while (!LogValues.empty())
-		{
-			OutValue += LogValues.front();
-			LogValues.pop();
-			rval = true;	// I'm doing this multiple times, but it was easier than having an extra check
+			Offset += TheLine.size() + 1;
 		}
 	}
-	return(rval);
+	return(LastBucket);
 }
-void GetMRTGOutput(const std::string& TheBlueToothAddressString, const int Minutes)
+// Returns the byte offset in the log file of the first line logged in the hour containing StartTime (or the nearest earlier indexed hour), or -1 if the log file has no usable index.
+off_t FindLogIndexOffset(const std::filesystem::path& LogFileName, const time_t StartTime)
 {
-	bdaddr_t TheAddress = { string2ba(TheBlueToothAddressString) };
-	Govee_Temp TheValue;
-	if (GetLogEntry(TheAddress, Minutes, TheValue))
+	off_t rval(-1);
+	std::map<time_t, off_t> TheIndex;
+	if (ReadLogIndex(LogFileName, TheIndex))
 	{
-		std::cout << std::dec; // make sure I'm putting things in decimal format
-		std::cout << TheValue.GetHumidity() * 1000.0 << std::endl; // current state of the second variable, normally 'outgoing bytes count'
-		std::cout << ((TheValue.GetTemperature() * 9.0 / 5.0) + 32.0) * 1000.0 << std::endl; // current state of the first variable, normally 'incoming bytes count'
-		std::cout << " " << std::endl; // string (in any human readable format), uptime of the target.
-		std::cout << TheBlueToothAddressString << std::endl; // string, name of the target.
+		auto Entry = TheIndex.upper_bound(StartTime);
+		if (Entry == TheIndex.begin())
+			rval = 0;
+		else
+			rval = (--Entry)->second;
 	}
+	return(rval);
 }
-/////////////////////////////////////////////////////////////////////////////
-std::map<bdaddr_t, std::vector<Govee_Temp>> GoveeMRTGLogs; // memory map of BT addresses and vector structure similar to MRTG Log Files
-std::map<bdaddr_t, std::string> GoveeBluetoothTitles;
-std::map<bdaddr_t, std::vector<Ruuvi_Tag>> RuuviMRTGLogs; // memory map of BT addresses and vector structure similar to MRTG Log Files
-/////////////////////////////////////////////////////////////////////////////
-std::filesystem::path GenerateCacheFileName(const bdaddr_t& TheBlueToothAddress, const ThermometerType TheThermometerType = ThermometerType::Unknown)
+// Log files written during the current write cycle, held open until SyncLogFiles so that they can all be synced together.
+std::vector<int> LogFilesPendingSync;
+bool LogDirectoryPendingSync(false);
+// Lines formatted by GenerateLogFile that haven't been appended to their log file yet. Without --stage they are written as soon as they are formatted.
+// With --stage they are held in memory and written in large appends when they get too old or use too much memory, which is much easier on an SD card.
+struct StagedLogFile {
+	std::string Buffer;	// complete lines, in the order they will be appended
+	std::vector<std::pair<time_t, size_t>> IndexEntries;	// hour and position in Buffer of the first line logged in each new hour
+	time_t Staged = 0;	// when the oldest line in Buffer was staged
+	time_t MostRecentData = 0;
+};
+std::map<std::filesystem::path, StagedLogFile> StagedLogFiles;
+const off_t LOG_PREALLOCATE(256 * 1024);	/* when staging, log files are extended on disk this much at a time */
+// Writes the whole buffer, continuing after partial writes and interrupted system calls.
+bool WriteAll(const int TheFile, const char* TheBuffer, const size_t TheLength)
 {
-	std::string btAddress(ba2string(TheBlueToothAddress));
-	for (auto pos = btAddress.find(':'); pos != std::string::npos; pos = btAddress.find(':'))
-		btAddress.erase(pos, 1);
-	std::ostringstream OutputFilename;
-	if (TheThermometerType == ThermometerType::RUUVI)
-		OutputFilename << "ruuvi-";
-	else
-		OutputFilename << "gvh-";
-	OutputFilename << btAddress;
-	OutputFilename << "-cache.txt";
-	std::filesystem::path CacheFileName(CacheDirectory / OutputFilename.str());
-	return(CacheFileName);
+	bool rval = true;
+	size_t Written = 0;
+	while (rval && (Written < TheLength))
+	{
+		ssize_t bufDataLen = write(TheFile, TheBuffer + Written, TheLength - Written);
+		if (bufDataLen > 0)
+			Written += bufDataLen;
+		else if (errno != EINTR)
+			rval = false;
+	}
+	return(rval);
 }
-template <typename T> bool GenerateCacheFile(const bdaddr_t& TheBlueToothAddress, const std::vector<T>& MRTGLog)
+// Writes the whole contents to a temporary file with one write and renames it into place, so a reader only ever sees the old file or the complete new one.
+// The modification time is set before the rename, so the file never appears with the wrong time.
+bool ReplaceFile(const std::filesystem::path& FileName, const std::string& Contents, const time_t ModificationTime)
 {
-	bool rval(false);
-	if (!MRTGLog.empty())
+	bool rval = false;
+	std::filesystem::path TempFileName(FileName.string() + ".tmp");
+	int TheFile = open(TempFileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+	if (TheFile >= 0)
 	{
-		std::filesystem::path MRTGCacheFile(GenerateCacheFileName(TheBlueToothAddress, MRTGLog[0].GetModel()));
-		struct stat64 Stat({ 0 });	// Zero the stat64 structure when it's allocated
-		stat64(MRTGCacheFile.c_str(), &Stat);	// This shouldn't change Stat if the file doesn't exist.
-		if (difftime(MRTGLog[0].Time, Stat.st_mtim.tv_sec) > 60 * 60) // If Cache File has data older than 60 minutes, write it
+		bool bWritten = WriteAll(TheFile, Contents.data(), Contents.size());
+		bWritten = (0 == close(TheFile)) && bWritten;
+		struct utimbuf ut({ 0 });
+		ut.actime = ModificationTime;
+		ut.modtime = ModificationTime;
+		if (bWritten && (0 == utime(TempFileName.c_str(), &ut)) && (0 == rename(TempFileName.c_str(), FileName.c_str())))
+			rval = true;
+		else
 		{
-			std::ofstream CacheFile(MRTGCacheFile, std::ios_base::out | std::ios_base::trunc);
-			if (CacheFile.is_open())
-			{
-				if (ConsoleVerbosity > 0)
-					std::cout << "[" << getTimeISO8601(true) << "] Writing: " << MRTGCacheFile.native() << std::endl;
-				else
-					std::cerr << "Writing: " << MRTGCacheFile.native() << std::endl;
-				CacheFile << "Cache: " << ba2string(TheBlueToothAddress) << " " << ProgramVersionString << std::endl;
-				for (auto & i : MRTGLog)
-					CacheFile << i.WriteCache() << std::endl;
-				CacheFile.close();
-				struct utimbuf ut({ 0 });
-				ut.actime = MRTGLog[0].Time;
-				ut.modtime = MRTGLog[0].Time;
-				utime(MRTGCacheFile.c_str(), &ut);
-				rval = true;
-			}
+			std::cerr << "Error: Unable to write " << FileName.native() << " " << strerror(errno) << std::endl;
+			std::error_code ec;
+			std::filesystem::remove(TempFileName, ec);
 		}
 	}
+	else
+		std::cerr << "Error: open " << TempFileName.native() << " " << strerror(errno) << std::endl;
 	return(rval);
 }
-template <typename T> void GenerateCacheFile(std::map<bdaddr_t, std::vector<T>> &AddressTemperatureMap)
+// Compresses a whole buffer into a gzip file image in memory. Returns an empty string if zlib fails.
+std::string GzipString(const std::string& Contents)
 {
-	if (!CacheDirectory.empty())
+	std::string rval;
+	z_stream Stream({ 0 });
+	if (Z_OK == deflateInit2(&Stream, Z_BEST_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY))	// adding 16 to the window bits writes a gzip header and trailer instead of zlib's
 	{
-		if (ConsoleVerbosity > 1)
-			std::cout << "[" << getTimeISO8601(true) << "] GenerateCacheFile: " << CacheDirectory.native() << std::endl;
-		for (auto const& [TheBlueToothAddress, MRTGLog] : AddressTemperatureMap)
-			GenerateCacheFile(TheBlueToothAddress, MRTGLog);
+		rval.resize(deflateBound(&Stream, Contents.size()));
+		Stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(Contents.data()));
+		Stream.avail_in = Contents.size();
+		Stream.next_out = reinterpret_cast<Bytef*>(&rval[0]);
+		Stream.avail_out = rval.size();
+		if (Z_STREAM_END == deflate(&Stream, Z_FINISH))
+			rval.resize(Stream.total_out);
+		else
+			rval.clear();
+		deflateEnd(&Stream);
 	}
+	return(rval);
 }
-void ReadCacheDirectory(void)
+// Writes FileName.gz next to a file just written, with the same modification time, for web servers like nginx with gzip_static that send it instead of compressing the file for every request.
+bool ReplaceGzipFile(const std::filesystem::path& FileName, const std::string& Contents, const time_t ModificationTime)
 {
-	const std::regex CacheFileRegex("^(gvh-|ruuvi-)[[:xdigit:]]{12}-cache.txt");
-	if (!CacheDirectory.empty())
+	bool rval = false;
+	const std::string Compressed(GzipString(Contents));
+	if (Compressed.empty())
+		std::cerr << "Error: Unable to compress " << FileName.native() << std::endl;
+	else
+		rval = ReplaceFile(FileName.string() + ".gz", Compressed, ModificationTime);
+	return(rval);
+}
+// Appends staged lines to a log file with a single write, and the matching entries to its hourly index.
+// If bWriteAll is false only the whole lines that fit in whole filesystem blocks are appended, ending the file at or just before a block boundary, and whatever is left over stays staged.
+// If the write fails nothing is consumed, the file is cut back to its old length, and false is returned.
+bool WriteStagedLogFile(const std::filesystem::path& filename, StagedLogFile& Staged, const bool bWriteAll)
+{
+	bool rval = false;
+	if (!Staged.Buffer.empty())
 	{
-		if (ConsoleVerbosity > 1)
-			std::cout << "[" << getTimeISO8601(true) << "] ReadCacheDirectory: " << CacheDirectory << std::endl;
-		std::deque<std::filesystem::path> files;
-		for (auto const& dir_entry : std::filesystem::directory_iterator{ CacheDirectory })
-			if (dir_entry.is_regular_file())
-				if (std::regex_match(dir_entry.path().filename().string(), CacheFileRegex))
-					files.push_back(dir_entry);
-		if (!files.empty())
+		const auto PerfStart(std::chrono::steady_clock::now());
+		int LogFile = open(filename.c_str(), O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0666);
+		struct stat64 LogStat({ 0 });
+		if ((LogFile >= 0) && (0 == fstat64(LogFile, &LogStat)))
 		{
-			sort(files.begin(), files.end());
-			while (!files.empty())
+			const off_t Offset(LogStat.st_size);
+			size_t Length(Staged.Buffer.size());
+			if (!bWriteAll)
+			{
+				const off_t BlockSize(LogStat.st_blksize > 0 ? LogStat.st_blksize : 4096);
+				const off_t BlockEnd(((Offset + off_t(Length)) / BlockSize) * BlockSize);
+				Length = (BlockEnd > Offset) ? size_t(BlockEnd - Offset) : 0;
+				// Only whole lines are appended, so readers never see a torn record and a restart never glues the next append onto half a line.
+				const auto LineEnd = (Length > 0) ? Staged.Buffer.rfind('\n', Length - 1) : std::string::npos;
+				Length = (LineEnd == std::string::npos) ? 0 : LineEnd + 1;
+			}
+			if (Length > 0)
 			{
-				std::ifstream TheFile(*files.begin());
-				if (TheFile.is_open())
+				if (Offset == 0)
+					LogDirectoryPendingSync = true;	// a new log file, so the directory entry needs to be synced too
+				if (StagingMinutes > 0)	// reserve space ahead of the appends so a month of data isn't scattered across the card
+					if ((LogStat.st_blocks * 512) < (Offset + off_t(Length)))
+						fallocate(LogFile, FALLOC_FL_KEEP_SIZE, Offset, std::max(off_t(Length), LOG_PREALLOCATE));	// errors (e.g. EOPNOTSUPP) are harmless
+				// All of the lines are appended with a single write, so a crash can't leave part of a line in the file unless the write itself is torn.
+				if (!WriteAll(LogFile, Staged.Buffer.data(), Length))
 				{
-					if (ConsoleVerbosity > 0)
-						std::cout << "[" << getTimeISO8601(true) << "] Reading: " << files.begin()->string() << std::endl;
-					else
-						std::cerr << "Reading: " << files.begin()->string() << std::endl;
-					std::string TheLine;
-					if (std::getline(TheFile, TheLine))
+					// Nothing is consumed, so the lines stay staged for the next cycle. Part of them may have reached the file, so it's cut back to where it ended.
+					std::cerr << "Error: write " << filename.native() << " " << strerror(errno) << std::endl;
+					if (0 != ftruncate(LogFile, Offset))
+						std::cerr << "Error: ftruncate " << filename.native() << " " << strerror(errno) << std::endl;
+					close(LogFile);
+				}
+				else
+				{
+					rval = true;
+					std::ostringstream IndexEntries;
+					auto Entry = Staged.IndexEntries.begin();
+					for (; (Entry != Staged.IndexEntries.end()) && (Entry->second < Length); Entry++)
+						IndexEntries << timeToExcelDate(Entry->first) << "\t" << Offset + off_t(Entry->second) << "\n";
+					Staged.IndexEntries.erase(Staged.IndexEntries.begin(), Entry);
+					for (auto& Remaining : Staged.IndexEntries)
+						Remaining.second -= Length;
+					Staged.Buffer.erase(0, Length);
+					if (!IndexEntries.str().empty())
 					{
-						const std::regex CacheFirstLineRegex("^Cache: ((([[:xdigit:]]{2}:){5}))[[:xdigit:]]{2}.*");
-						// every Cache File should have a start line with the name Cache, the Bluetooth Address, and the creator version. 
-						// TODO: check to make sure the version is compatible
-						if (std::regex_match(TheLine, CacheFirstLineRegex))
-						{
-							std::smatch BluetoothAddress;
-							if (std::regex_search(TheLine, BluetoothAddress, BluetoothAddressRegex))
-							{
-								bdaddr_t TheBlueToothAddress(string2ba(BluetoothAddress.str()));
-								const std::regex GoveeCacheFileRegex("^gvh-[[:xdigit:]]{12}-cache.txt");
-								const std::regex RuuviCacheFileRegex("^ruuvi-[[:xdigit:]]{12}-cache.txt");
-								if (std::regex_match(files.begin()->filename().string(), GoveeCacheFileRegex))
-								{
-									ThermometerType CacheThermometerType = ThermometerType::Unknown;
-									auto foo = GoveeThermometers.find(TheBlueToothAddress);
-									if (foo != GoveeThermometers.end())
-										CacheThermometerType = foo->second;
-									std::vector<Govee_Temp> FakeMRTGFile;
-									FakeMRTGFile.reserve(2 + DAY_COUNT + WEEK_COUNT + MONTH_COUNT + YEAR_COUNT); // this might speed things up slightly
-									while (std::getline(TheFile, TheLine))
-									{
-										Govee_Temp TheValue;
-										TheValue.ReadCache(TheLine);
-										if (TheValue.GetModel() == ThermometerType::Unknown)
-											TheValue.SetModel(CacheThermometerType);
-										FakeMRTGFile.push_back(TheValue);
-									}
-									if (FakeMRTGFile.size() == (2 + DAY_COUNT + WEEK_COUNT + MONTH_COUNT + YEAR_COUNT)) // simple check to see if we are the right size
-										GoveeMRTGLogs.insert(std::pair<bdaddr_t, std::vector<Govee_Temp>>(TheBlueToothAddress, FakeMRTGFile));
-								}
-								else if (std::regex_match(files.begin()->filename().string(), RuuviCacheFileRegex))
-								{
-									std::vector<Ruuvi_Tag> FakeMRTGFile;
-									FakeMRTGFile.reserve(2 + DAY_COUNT + WEEK_COUNT + MONTH_COUNT + YEAR_COUNT); // this might speed things up slightly
-									while (std::getline(TheFile, TheLine))
-									{
-										Ruuvi_Tag TheValue;
-										TheValue.ReadCache(TheLine);
-										FakeMRTGFile.push_back(TheValue);
-									}
-									if (FakeMRTGFile.size() == (2 + DAY_COUNT + WEEK_COUNT + MONTH_COUNT + YEAR_COUNT)) // simple check to see if we are the right size
-										RuuviMRTGLogs.insert(std::pair<bdaddr_t, std::vector<Ruuvi_Tag>>(TheBlueToothAddress, FakeMRTGFile));
-								}
-							}
-						}
+						std::ofstream IndexFile(GenerateLogIndexFileName(filename), std::ios_base::out | std::ios_base::app);
+						if (IndexFile.is_open())
+							IndexFile << IndexEntries.str();
 					}
-					TheFile.close();
+					struct utimbuf Log_ut({ 0 });
+					Log_ut.actime = Staged.MostRecentData;
+					Log_ut.modtime = Staged.MostRecentData;
+					utime(filename.c_str(), &Log_ut);
+					LogFilesPendingSync.push_back(LogFile);	// closed by SyncLogFiles at the end of the write cycle
+					if (ConsoleVerbosity > 1)
+						std::cout << "[" << getTimeISO8601(true) << "] Writing: " << filename.native() << " (" << Length << " bytes)" << std::endl;
+					PerfStats.LogFlush.Add(PerfStart, Length);
 				}
-				files.pop_front();
 			}
+			else
+				close(LogFile);
+		}
+		else
+		{
+			std::cerr << "Error: open " << filename.native() << " " << strerror(errno) << std::endl;
+			if (LogFile >= 0)
+				close(LogFile);
 		}
 	}
+	return(rval);
 }
-/////////////////////////////////////////////////////////////////////////////
-enum class GraphType { daily, weekly, monthly, yearly};
-// Returns a curated vector of data points specific to the requested graph type read directly from a real MRTG log file on disk.
-void ReadMRTGData(const std::filesystem::path& MRTGLogFileName, std::vector<Govee_Temp>& TheValues, const GraphType graph = GraphType::daily)
+// Writes out staged log data that has been held longer than --stage minutes. If all the staged data together is larger than --stage-kb,
+// the whole lines in whole blocks of every file are written as well. With bFlushAll everything is written, which must happen before the program exits.
+void FlushStagedLogFiles(const bool bFlushAll)
 {
-	std::ifstream TheInFile(MRTGLogFileName);
-	if (TheInFile.is_open())
+	time_t TimeNow;
+	time(&TimeNow);
+	size_t StagedBytes = 0;
+	for (auto const& [filename, Staged] : StagedLogFiles)
+		StagedBytes += Staged.Buffer.size();
+	const bool bOverBudget = StagedBytes > (StagingKiloBytes * 1024);
+	for (auto& [filename, Staged] : StagedLogFiles)
 	{
-		TheValues.clear();
-		std::string Line;
-		while (std::getline(TheInFile, Line))
-		{
-			std::stringstream Source(Line);
+		if (bFlushAll || (difftime(TimeNow, Staged.Staged) >= (StagingMinutes * 60)))
+			WriteStagedLogFile(filename, Staged, true);
+		else if (bOverBudget)
+			WriteStagedLogFile(filename, Staged, false);
+	}
+}
+// Completes a write cycle started by one or more calls to GenerateLogFile. With --durability set, every log file written in the cycle is synced here, once, instead of flushing each line as it's written.
+// bFinal writes out anything still staged in memory, and is used when the program is exiting.
+void SyncLogFiles(const bool bFinal = false)
+{
+	if (bFinal || (StagingMinutes > 0))
+		FlushStagedLogFiles(bFinal);
+	for (auto const& TheFile : LogFilesPendingSync)
+	{
+		if (LogDurability > 0)
+			if (0 != fdatasync(TheFile))
+				std::cerr << "Error: fdatasync " << strerror(errno) << std::endl;
+		close(TheFile);
+	}
+	if (LogDirectoryPendingSync && (LogDurability > 1))
+	{
+		int TheDirectory = open(LogDirectory.c_str(), O_RDONLY | O_DIRECTORY);
+		if (TheDirectory >= 0)
+		{
+			if (0 != fsync(TheDirectory))
+				std::cerr << "Error: fsync " << LogDirectory << " " << strerror(errno) << std::endl;
+			close(TheDirectory);
+		}
+	}
+	if ((ConsoleVerbosity > 1) && (LogDurability > 0) && !LogFilesPendingSync.empty())
+		std::cout << "[" << getTimeISO8601(true) << "] Synced " << LogFilesPendingSync.size() << " log files" << std::endl;
+	LogFilesPendingSync.clear();
+	LogDirectoryPendingSync = false;
+}
+template <typename T> bool GenerateLogFile(std::map<bdaddr_t, std::queue<T>> &AddressTemperatureMap)
+{
+	TRACE_SCOPE("log flush");
+	bool rval = false;
+	if (!LogDirectory.empty())
+	{
+		if (ConsoleVerbosity > 1)
+			std::cout << "[" << getTimeISO8601(true) << "] GenerateLogFile: " << LogDirectory.native() << std::endl;
+		for (auto& [TheAddress, LogData] : AddressTemperatureMap)
+		{
+			if (!LogData.empty()) // Only open the log file if there are entries to add
+			{
+				std::filesystem::path filename(GenerateLogFileName(TheAddress, LogData.front().GetModel()));
+				auto LastBucket = LogIndexLastBucket.find(filename);
+				if (LastBucket == LogIndexLastBucket.end())
+				{
+					std::map<time_t, off_t> TheIndex;
+					if (ReadLogIndex(filename, TheIndex))
+						LastBucket = LogIndexLastBucket.insert_or_assign(filename, TheIndex.rbegin()->first).first;
+					else
+						LastBucket = LogIndexLastBucket.insert_or_assign(filename, BuildLogIndex(filename)).first;
+				}
+				StagedLogFile& Staged = StagedLogFiles[filename];
+				if (Staged.Buffer.empty())
+					time(&Staged.Staged);
+				while (!LogData.empty())
+				{
+					time_t Bucket = (LogData.front().Time / LOG_INDEX_BUCKET) * LOG_INDEX_BUCKET;
+					if (Bucket > LastBucket->second)
+					{
+						Staged.IndexEntries.push_back(std::make_pair(Bucket, Staged.Buffer.size()));
+						LastBucket->second = Bucket;
+					}
+					Staged.Buffer.append(LogData.front().WriteTXT());
+					Staged.Buffer.push_back('\n');
+					LoggerStats.LogLines++;
+					Staged.MostRecentData = std::max(LogData.front().Time, Staged.MostRecentData);
+					LogData.pop();
+				}
+				if (StagingMinutes > 0)
+					rval = true;
+				else
+					rval = WriteStagedLogFile(filename, Staged, true) || rval;
+			}
+		}
+	}
+	else
+	{
+		// clear the queued data if LogDirectory not specified
+		for (auto& [TheAddress, LogData] : AddressTemperatureMap)
+			while (!LogData.empty())
+				LogData.pop();
+	}
+	return(rval);
+}
+// Decompresses a whole log file compressed by CompressLogFile into memory. A file with more than one gzip member is read as one stream.
+bool ReadCompressedLogFile(const std::filesystem::path& filename, std::string& TheContents)
+{
+	bool rval = false;
+	gzFile TheFile = gzopen(filename.c_str(), "rb");
+	if (TheFile != NULL)
+	{
+		gzbuffer(TheFile, 128 * 1024);
+		char buf[64 * 1024];
+		int bufDataLen;
+		while ((bufDataLen = gzread(TheFile, buf, sizeof(buf))) > 0)
+			TheContents.append(buf, bufDataLen);
+		int errnum = Z_OK;
+		const char* ErrorString = gzerror(TheFile, &errnum);
+		if ((bufDataLen < 0) || ((errnum != Z_OK) && (errnum != Z_BUF_ERROR)))	// Z_BUF_ERROR is a truncated file, keep what could be read
+			std::cerr << "Error: gzread " << filename.string() << " " << ErrorString << std::endl;
+		else
+			rval = true;
+		gzclose(TheFile);
+	}
+	else
+		std::cerr << "Error: gzopen " << filename.string() << " " << strerror(errno) << std::endl;
+	return(rval);
+}
+// Reads a log file one line at a time from the end towards the start, reading the file in large blocks instead of a character at a time.
+// Only complete lines are returned. A last line without its newline may still be being written, so it's skipped.
+// Compressed log files are decompressed into memory and walked the same way.
+class LogFileReverseReader {
+public:
+	LogFileReverseReader(const std::filesystem::path& filename);
+	LogFileReverseReader(const LogFileReverseReader&) = delete;
+	LogFileReverseReader& operator=(const LogFileReverseReader&) = delete;
+	~LogFileReverseReader() { if (TheFile >= 0) close(TheFile); };
+	bool is_open(void) const { return(bOpen); };
+	bool PreviousLine(std::string_view& TheLine);	// TheLine is only valid until the next call
+protected:
+	bool ReadPreviousBlock(void);
+	static const off_t BlockSize = 64 * 1024;
+	int TheFile;
+	bool bOpen;
+	bool bTrimmed;	// any unfinished last line has been skipped
+	off_t BufferStart;	// file offset of the first byte in Buffer
+	size_t Position;	// end of the part of Buffer that hasn't been returned yet
+	std::string Buffer;
+};
+LogFileReverseReader::LogFileReverseReader(const std::filesystem::path& filename) : TheFile(-1), bOpen(false), bTrimmed(false), BufferStart(0), Position(0)
+{
+	if (filename.extension() == ".gz")
+		bOpen = ReadCompressedLogFile(filename, Buffer);
+	else
+	{
+		TheFile = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+		struct stat64 FileStat({ 0 });
+		if ((TheFile >= 0) && (0 == fstat64(TheFile, &FileStat)))
+		{
+			BufferStart = FileStat.st_size;
+			bOpen = true;
+		}
+	}
+	Position = Buffer.size();
+}
+// Adds the block before the start of Buffer to the front of it, keeping only the part of Buffer that hasn't been returned yet.
+// Reads start on a block boundary, so after the first one every read is a whole aligned block. Returns false at the start of the file.
+bool LogFileReverseReader::ReadPreviousBlock(void)
+{
+	bool rval = false;
+	if (BufferStart > 0)
+	{
+		const off_t NewStart(((BufferStart - 1) / BlockSize) * BlockSize);
+		const size_t Length(BufferStart - NewStart);
+		Buffer.erase(Position);
+		Buffer.insert(0, Length, '\0');
+		if (ssize_t(Length) == pread(TheFile, Buffer.data(), Length, NewStart))
+		{
+			BufferStart = NewStart;
+			Position += Length;
+		}
+		else
+		{
+			std::cerr << "Error: read " << strerror(errno) << std::endl;
+			BufferStart = 0;
+			Buffer.clear();
+			Position = 0;
+		}
+		rval = true;
+	}
+	return(rval);
+}
+bool LogFileReverseReader::PreviousLine(std::string_view& TheLine)
+{
+	bool rval = false;
+	bool bMore = bOpen;
+	while (bMore && !rval)
+	{
+		if (!bTrimmed)	// back up to just after the last newline in the file
+		{
+			const size_t LastNewline = (Position > 0) ? Buffer.rfind('\n', Position - 1) : std::string::npos;
+			if (LastNewline != std::string::npos)
+			{
+				Position = LastNewline + 1;
+				bTrimmed = true;
+			}
+			else if (!ReadPreviousBlock())
+				bMore = false;	// no complete lines at all
+		}
+		else if (Position == 0)
+			bMore = false;
+		else
+		{
+			// Buffer[Position - 1] is the newline ending the line, which starts after the newline before it.
+			const size_t LineStart = (Position > 1) ? Buffer.rfind('\n', Position - 2) : std::string::npos;
+			if (LineStart != std::string::npos)
+			{
+				TheLine = std::string_view(Buffer.data() + LineStart + 1, Position - LineStart - 2);
+				Position = LineStart + 1;
+				rval = true;
+			}
+			else if (!ReadPreviousBlock())	// the first line in the file
+			{
+				TheLine = std::string_view(Buffer.data(), Position - 1);
+				Position = 0;
+				rval = true;
+			}
+		}
+	}
+	return(rval);
+}
+// Reads a number from the start of a log file field, like std::from_chars.
+bool ReadLogEntryField(const std::string_view Field, double& Value)
+{
+#ifdef __cpp_lib_to_chars
+	return(std::from_chars(Field.data(), Field.data() + Field.size(), Value).ec == std::errc());
+#else
+	// Before GCC 11 the standard library only has from_chars for integers, and strtod needs its input terminated
+	char buffer[64];
+	const size_t Length(std::min(Field.size(), sizeof(buffer) - 1));
+	Field.copy(buffer, Length);
+	buffer[Length] = 0;
+	char* End = buffer;
+	Value = strtod(buffer, &End);
+	return(End != buffer);
+#endif // __cpp_lib_to_chars
+}
+// Reads the date, temperature, humidity, and battery from the start of a log file line.
+bool ReadLogEntryLine(const std::string_view TheLine, const ThermometerType TheThermometerType, Govee_Temp& TheValue)
+{
+	bool rval = false;
+	std::string_view Fields[4];
+	size_t FieldStart = 0;
+	for (auto& Field : Fields)
+	{
+		if (FieldStart <= TheLine.size())
+		{
+			size_t FieldEnd = TheLine.find('\t', FieldStart);
+			if (FieldEnd == std::string_view::npos)
+				FieldEnd = TheLine.size();
+			Field = TheLine.substr(FieldStart, FieldEnd - FieldStart);
+			FieldStart = FieldEnd + 1;
+		}
+	}
+	double Temperature(0);
+	double Humidity(0);
+	int Battery(0);
+	if ((Fields[0].size() >= 19) &&
+		ReadLogEntryField(Fields[1], Temperature) &&
+		ReadLogEntryField(Fields[2], Humidity) &&
+		(std::from_chars(Fields[3].data(), Fields[3].data() + Fields[3].size(), Battery).ec == std::errc()))
+	{
+		TheValue = Govee_Temp(ISO8601totime(std::string(Fields[0])), Temperature, Humidity, Battery);
+		TheValue.SetModel(TheThermometerType);	// without a model the value isn't valid, and would be ignored when averaging
+		rval = true;
+	}
+	return(rval);
+}
+// Adds the values logged at or after WindowStart to LogValues, reading back from the end of the file until the first older line.
+// NewestValue is set to the newest readable line in the file if it's newer than what it already holds.
+void ReadRecentLogEntries(const std::filesystem::path& filename, const time_t WindowStart, const ThermometerType TheThermometerType, std::queue<Govee_Temp>& LogValues, Govee_Temp& NewestValue)
+{
+	LogFileReverseReader TheFile(filename);
+	std::string_view TheLine;
+	bool bInWindow = true;
+	while (bInWindow && TheFile.PreviousLine(TheLine))
+	{
+		Govee_Temp TheValue;
+		if (ReadLogEntryLine(TheLine, TheThermometerType, TheValue))
+		{
+			if (TheValue.Time > NewestValue.Time)
+				NewestValue = TheValue;
+			if (TheValue.Time < WindowStart)	// If this entry is more than Minutes parameter from current time, it's time to stop reading log file.
+				bInWindow = false;
+			else
+				LogValues.push(TheValue);
+		}
+	}
+}
+bool GetLogEntry(const bdaddr_t &InAddress, const int Minutes, Govee_Temp & OutValue)
+{
+	// Returned value is now the average of whatever values were recorded over the previous 5 minutes
+	bool rval = false;
+	time_t now = ISO8601totime(getTimeISO8601());
+	const time_t WindowStart(now - (Minutes * 60));
+	// Only the temperature and humidity are reported, so any model will do when this process doesn't know the device.
+	ThermometerType TheThermometerType(ThermometerType::H5075);
+	auto foo = GoveeThermometers.find(InAddress);
+	if (foo != GoveeThermometers.end())
+		TheThermometerType = foo->second;
+	time_t MonthStart(now);
+	struct tm UTC;
+	if (0 != gmtime_r(&now, &UTC))
+		MonthStart -= ((UTC.tm_mday - 1) * 24 + UTC.tm_hour) * 60 * 60 + UTC.tm_min * 60 + UTC.tm_sec;
+	std::queue<Govee_Temp> LogValues;
+	Govee_Temp NewestValue;
+	std::filesystem::path LogFileName(GenerateLogFileName(InAddress, ThermometerType::Unknown, now));
+	if (std::filesystem::exists(LogFileName))
+		ReadRecentLogEntries(LogFileName, WindowStart, TheThermometerType, LogValues, NewestValue);
+	// Log files are monthly, so last month's file is needed when the averaging window started last month, or nothing has been logged this month yet.
+	// Last month may have been compressed, possibly with a few lines downloaded since then in a new uncompressed file.
+	if ((WindowStart < MonthStart) || (NewestValue.Time == 0))
+	{
+		std::filesystem::path PreviousLogFileName(GenerateLogFileName(InAddress, ThermometerType::Unknown, MonthStart - 1));
+		if (std::filesystem::exists(PreviousLogFileName))
+			ReadRecentLogEntries(PreviousLogFileName, WindowStart, TheThermometerType, LogValues, NewestValue);
+		PreviousLogFileName += ".gz";
+		if (std::filesystem::exists(PreviousLogFileName))
+			ReadRecentLogEntries(PreviousLogFileName, WindowStart, TheThermometerType, LogValues, NewestValue);
+	}
+	if ((Minutes == 0) && LogValues.empty() && (NewestValue.Time != 0)) // HACK: Special Case to always accept the last logged value
+		LogValues.push(NewestValue);
+	if (!LogValues.empty())
+		OutValue = Govee_Temp();
+	while (!LogValues.empty())
+	{
+		OutValue += LogValues.front();
+		LogValues.pop();
+		rval = true;	// I'm doing this multiple times, but it was easier than having an extra check
+	}
+	return(rval);
+}
+// The four lines MRTG expects from an external program
+template <typename T> std::string MRTGOutput(const std::string& TheBlueToothAddressString, const T& TheValue)
+{
+	std::ostringstream ssOutput;
+	ssOutput << std::dec; // make sure I'm putting things in decimal format
+	ssOutput << TheValue.GetHumidity() * 1000.0 << "\n"; // current state of the second variable, normally 'outgoing bytes count'
+	ssOutput << ((TheValue.GetTemperature() * 9.0 / 5.0) + 32.0) * 1000.0 << "\n"; // current state of the first variable, normally 'incoming bytes count'
+	ssOutput << " " << "\n"; // string (in any human readable format), uptime of the target.
+	ssOutput << TheBlueToothAddressString << "\n"; // string, name of the target.
+	return(ssOutput.str());
+}
+void GetMRTGOutput(const std::string& TheBlueToothAddressString, const int Minutes)
+{
+	bdaddr_t TheAddress = { string2ba(TheBlueToothAddressString) };
+	Govee_Temp TheValue;
+	if (GetLogEntry(TheAddress, Minutes, TheValue))
+		std::cout << MRTGOutput(TheBlueToothAddressString, TheValue) << std::flush;
+}
+/////////////////////////////////////////////////////////////////////////////
+std::map<bdaddr_t, std::vector<Govee_Temp>> GoveeMRTGLogs; // memory map of BT addresses and vector structure similar to MRTG Log Files
+std::map<bdaddr_t, std::string> GoveeBluetoothTitles;
+std::map<bdaddr_t, std::vector<Ruuvi_Tag>> RuuviMRTGLogs; // memory map of BT addresses and vector structure similar to MRTG Log Files
+/////////////////////////////////////////////////////////////////////////////
+std::filesystem::path GenerateCacheFileName(const bdaddr_t& TheBlueToothAddress, const ThermometerType TheThermometerType = ThermometerType::Unknown)
+{
+	std::string btAddress(ba2string(TheBlueToothAddress));
+	for (auto pos = btAddress.find(':'); pos != std::string::npos; pos = btAddress.find(':'))
+		btAddress.erase(pos, 1);
+	std::ostringstream OutputFilename;
+	if (TheThermometerType == ThermometerType::RUUVI)
+		OutputFilename << "ruuvi-";
+	else
+		OutputFilename << "gvh-";
+	OutputFilename << btAddress;
+	OutputFilename << "-cache.bin";
+	std::filesystem::path CacheFileName(CacheDirectory / OutputFilename.str());
+	return(CacheFileName);
+}
+// Binary cache files are a fixed header followed by the vector of samples exactly as it is laid out in memory. That layout depends on the
+// compiler and architecture, so the header records enough to reject a file written by an incompatible build, which is then simply ignored.
+const char MRTG_CACHE_MAGIC[8] = { 'G', 'V', 'H', 'C', 'A', 'C', 'H', 'E' };
+const char MRTG_JOURNAL_MAGIC[8] = { 'G', 'V', 'H', 'J', 'O', 'U', 'R', 'N' };
+const uint32_t MRTG_CACHE_VERSION(1);
+struct MRTGCacheHeader {
+	char Magic[8];
+	uint32_t Version;
+	uint32_t RecordSize;	// sizeof the sample class
+	uint32_t TierSizes[4];	// DAY_COUNT, WEEK_COUNT, MONTH_COUNT, YEAR_COUNT
+	uint32_t RecordCount;
+	uint32_t Checksum;	// crc32 of the samples. In a journal, the checksum of the cache file it applies to.
+	uint8_t Address[6];	// bdaddr_t byte order
+	uint8_t Reserved[2];
+};
+template <typename T> MRTGCacheHeader MakeCacheHeader(const char* Magic, const bdaddr_t& TheBlueToothAddress, const uint32_t RecordCount, const uint32_t Checksum)
+{
+	MRTGCacheHeader Header({ 0 });
+	memcpy(Header.Magic, Magic, sizeof(Header.Magic));
+	Header.Version = MRTG_CACHE_VERSION;
+	Header.RecordSize = sizeof(T);
+	Header.TierSizes[0] = DAY_COUNT;
+	Header.TierSizes[1] = WEEK_COUNT;
+	Header.TierSizes[2] = MONTH_COUNT;
+	Header.TierSizes[3] = YEAR_COUNT;
+	Header.RecordCount = RecordCount;
+	Header.Checksum = Checksum;
+	memcpy(Header.Address, TheBlueToothAddress.b, sizeof(Header.Address));
+	return(Header);
+}
+template <typename T> bool CacheHeaderMatches(const MRTGCacheHeader& Header, const char* Magic)
+{
+	return((0 == memcmp(Header.Magic, Magic, sizeof(Header.Magic))) &&
+		(Header.Version == MRTG_CACHE_VERSION) &&
+		(Header.RecordSize == sizeof(T)) &&
+		(Header.TierSizes[0] == DAY_COUNT) &&
+		(Header.TierSizes[1] == WEEK_COUNT) &&
+		(Header.TierSizes[2] == MONTH_COUNT) &&
+		(Header.TierSizes[3] == YEAR_COUNT));
+}
+// Rewriting the whole cache file for every device each write cycle would be most of what the program writes, so changes are appended to a journal
+// (-cache.jnl) instead. Each write cycle appends the samples pushed onto the front of each tier since the last one, then the current value and the
+// accumulator. Once the journal is as large as the cache file, the cache file is rewritten and the journal started again.
+struct MRTGJournalRecord {
+	uint32_t Kind;	// 0 = current value, 1 = accumulator, 2 to 5 = sample pushed onto the front of the day, week, month or year tier
+	uint32_t Checksum;	// crc32 of Kind and the sample that follows, so a record torn by a crash ends the replay
+};
+struct MRTGJournal {
+	uint32_t CacheChecksum = 0;	// checksum of the cache file the journal applies to
+	off_t Size = 0;	// size of the journal file, zero until this process has a cache file and journal it can append to
+	time_t Time = 0;	// time of the current value when the journal was last written
+	size_t Pushed[4] = { 0, 0, 0, 0 };	// samples pushed onto the front of the day, week, month and year tiers since the journal was last written
+};
+std::map<bdaddr_t, MRTGJournal> MRTGJournals;
+// Counts the changes to the day, week, month and year tiers of a device's data, so graphs of tiers that haven't changed since they were last written aren't copied or drawn again.
+struct MRTGGeneration {
+	unsigned long long Tier[4] = { 0, 0, 0, 0 };
+};
+std::map<bdaddr_t, MRTGGeneration> MRTGGenerations;	// incremented by UpdateMRTGData
+std::map<bdaddr_t, MRTGGeneration> SVGGenerations;	// the generations of the graphs last written to SVGDirectory
+const size_t MRTG_TIER_FIRST[4] = { 2, 2 + DAY_COUNT, 2 + DAY_COUNT + WEEK_COUNT, 2 + DAY_COUNT + WEEK_COUNT + MONTH_COUNT };
+const size_t MRTG_TIER_COUNT[4] = { DAY_COUNT, WEEK_COUNT, MONTH_COUNT, YEAR_COUNT };
+std::filesystem::path GenerateJournalFileName(const std::filesystem::path& CacheFileName)
+{
+	return(std::filesystem::path(CacheFileName).replace_extension(".jnl"));
+}
+template <typename T> uint32_t JournalRecordChecksum(const uint32_t Kind, const T& TheValue)
+{
+	uLong Checksum = crc32(crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef*>(&Kind), sizeof(Kind));
+	return(crc32(Checksum, reinterpret_cast<const Bytef*>(&TheValue), sizeof(T)));
+}
+template <typename T> void ReplayJournalRecord(std::vector<T>& MRTGLog, const uint32_t Kind, const T& TheValue)
+{
+	if (Kind < 2)
+		MRTGLog[Kind] = TheValue;
+	else
+	{
+		auto TierFirst = MRTGLog.begin() + MRTG_TIER_FIRST[Kind - 2];
+		auto TierLast = TierFirst + MRTG_TIER_COUNT[Kind - 2];
+		std::copy_backward(TierFirst, TierLast - 1, TierLast);
+		*TierFirst = TheValue;
+	}
+}
+// Writes the complete cache file for a device and starts an empty journal to follow it.
+template <typename T> bool WriteCacheSnapshot(const bdaddr_t& TheBlueToothAddress, const std::vector<T>& MRTGLog, MRTGJournal& Journal)
+{
+	static_assert(std::is_trivially_copyable<T>::value, "cache files are written as raw sample memory");
+	bool rval(false);
+	std::filesystem::path MRTGCacheFile(GenerateCacheFileName(TheBlueToothAddress, MRTGLog[0].GetModel()));
+	const uint32_t Checksum(crc32(crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef*>(MRTGLog.data()), MRTGLog.size() * sizeof(T)));
+	const MRTGCacheHeader Header(MakeCacheHeader<T>(MRTG_CACHE_MAGIC, TheBlueToothAddress, MRTGLog.size(), Checksum));
+	// Write a temporary file and rename it over the cache file, so losing power part way through leaves the previous cache intact.
+	std::filesystem::path TempCacheFile(MRTGCacheFile.string() + ".tmp");
+	int CacheFile = open(TempCacheFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+	if (CacheFile >= 0)
+	{
+		if (ConsoleVerbosity > 0)
+			std::cout << "[" << getTimeISO8601(true) << "] Writing: " << MRTGCacheFile.native() << std::endl;
+		else
+			std::cerr << "Writing: " << MRTGCacheFile.native() << std::endl;
+		bool bWritten = WriteAll(CacheFile, reinterpret_cast<const char*>(&Header), sizeof(Header)) &&
+			WriteAll(CacheFile, reinterpret_cast<const char*>(MRTGLog.data()), MRTGLog.size() * sizeof(T)) &&
+			(0 == fdatasync(CacheFile));
+		close(CacheFile);
+		if (bWritten && (0 == rename(TempCacheFile.c_str(), MRTGCacheFile.c_str())))
+		{
+			struct utimbuf ut({ 0 });
+			ut.actime = MRTGLog[0].Time;
+			ut.modtime = MRTGLog[0].Time;
+			utime(MRTGCacheFile.c_str(), &ut);
+			std::error_code ec;
+			std::filesystem::remove(std::filesystem::path(MRTGCacheFile).replace_extension(".txt"), ec);	// the text cache written by earlier versions is now out of date
+			rval = true;
+		}
+		else
+		{
+			std::cerr << "Error: Unable to write " << MRTGCacheFile.native() << " " << strerror(errno) << std::endl;
+			std::error_code ec;
+			std::filesystem::remove(TempCacheFile, ec);
+		}
+	}
+	Journal = MRTGJournal();
+	if (rval)
+	{
+		// If this is interrupted, the old journal's checksum won't match the new cache file and it will be ignored.
+		const MRTGCacheHeader JournalHeader(MakeCacheHeader<T>(MRTG_JOURNAL_MAGIC, TheBlueToothAddress, 0, Checksum));
+		std::filesystem::path MRTGJournalFile(GenerateJournalFileName(MRTGCacheFile));
+		int JournalFile = open(MRTGJournalFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+		if ((JournalFile >= 0) && WriteAll(JournalFile, reinterpret_cast<const char*>(&JournalHeader), sizeof(JournalHeader)))
+		{
+			Journal.CacheChecksum = Checksum;
+			Journal.Size = sizeof(JournalHeader);
+			Journal.Time = MRTGLog[0].Time;
+		}
+		else
+			std::cerr << "Error: Unable to write " << MRTGJournalFile.native() << " " << strerror(errno) << std::endl;
+		if (JournalFile >= 0)
+			close(JournalFile);
+	}
+	return(rval);
+}
+// Appends what has changed in a device's tiers since the journal was last written, with a single write.
+template <typename T> bool AppendCacheJournal(const bdaddr_t& TheBlueToothAddress, const std::vector<T>& MRTGLog, MRTGJournal& Journal)
+{
+	bool rval(false);
+	std::string Buffer;
+	for (auto Tier = 0; Tier < 4; Tier++)
+		for (auto index = Journal.Pushed[Tier]; index > 0; index--)	// oldest first, the order they were pushed
+		{
+			const uint32_t Kind(Tier + 2);
+			const T& TheValue(MRTGLog[MRTG_TIER_FIRST[Tier] + index - 1]);
+			const MRTGJournalRecord Record({ Kind, JournalRecordChecksum(Kind, TheValue) });
+			Buffer.append(reinterpret_cast<const char*>(&Record), sizeof(Record));
+			Buffer.append(reinterpret_cast<const char*>(&TheValue), sizeof(T));
+		}
+	for (uint32_t Kind = 0; Kind < 2; Kind++)
+	{
+		const MRTGJournalRecord Record({ Kind, JournalRecordChecksum(Kind, MRTGLog[Kind]) });
+		Buffer.append(reinterpret_cast<const char*>(&Record), sizeof(Record));
+		Buffer.append(reinterpret_cast<const char*>(&MRTGLog[Kind]), sizeof(T));
+	}
+	std::filesystem::path MRTGJournalFile(GenerateJournalFileName(GenerateCacheFileName(TheBlueToothAddress, MRTGLog[0].GetModel())));
+	int JournalFile = open(MRTGJournalFile.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+	if (JournalFile >= 0)
+	{
+		if (WriteAll(JournalFile, Buffer.data(), Buffer.size()) && ((LogDurability == 0) || (0 == fdatasync(JournalFile))))
+		{
+			if (ConsoleVerbosity > 1)
+				std::cout << "[" << getTimeISO8601(true) << "] Writing: " << MRTGJournalFile.native() << " (" << Buffer.size() << " bytes)" << std::endl;
+			Journal.Size += Buffer.size();
+			Journal.Time = MRTGLog[0].Time;
+			std::fill(std::begin(Journal.Pushed), std::end(Journal.Pushed), 0);
+			rval = true;
+		}
+		close(JournalFile);
+	}
+	if (!rval)
+	{
+		std::cerr << "Error: Unable to write " << MRTGJournalFile.native() << " " << strerror(errno) << std::endl;
+		Journal.Size = 0;	// the journal may now end with a partial record, so rewrite the cache file next time
+	}
+	return(rval);
+}
+template <typename T> bool GenerateCacheFile(const bdaddr_t& TheBlueToothAddress, const std::vector<T>& MRTGLog)
+{
+	bool rval(false);
+	if (!MRTGLog.empty())
+	{
+		MRTGJournal& Journal(MRTGJournals[TheBlueToothAddress]);
+		bool bSnapshot = (Journal.Size == 0) || (Journal.Size >= off_t(sizeof(MRTGCacheHeader) + MRTGLog.size() * sizeof(T)));
+		bool bChanged = (Journal.Time != MRTGLog[0].Time);
+		for (auto Tier = 0; Tier < 4; Tier++)
+		{
+			if (Journal.Pushed[Tier] > 0)
+				bChanged = true;
+			if (Journal.Pushed[Tier] >= MRTG_TIER_COUNT[Tier])	// the whole tier has changed
+				bSnapshot = true;
+		}
+		const auto PerfStart(std::chrono::steady_clock::now());
+		const off_t JournalSize(Journal.Size);
+		if (bSnapshot)
+		{
+			rval = WriteCacheSnapshot(TheBlueToothAddress, MRTGLog, Journal);
+			if (rval)
+			{
+				LoggerStats.CacheSnapshots++;
+				PerfStats.CacheFlush.Add(PerfStart, sizeof(MRTGCacheHeader) + MRTGLog.size() * sizeof(T) + Journal.Size);
+			}
+		}
+		else if (bChanged)
+		{
+			rval = AppendCacheJournal(TheBlueToothAddress, MRTGLog, Journal);
+			if (rval)
+			{
+				LoggerStats.CacheJournalAppends++;
+				PerfStats.CacheFlush.Add(PerfStart, Journal.Size - JournalSize);
+			}
+		}
+	}
+	return(rval);
+}
+template <typename T> void GenerateCacheFile(std::map<bdaddr_t, std::vector<T>> &AddressTemperatureMap)
+{
+	TRACE_SCOPE("cache flush");
+	if (!CacheDirectory.empty())
+	{
+		if (ConsoleVerbosity > 1)
+			std::cout << "[" << getTimeISO8601(true) << "] GenerateCacheFile: " << CacheDirectory.native() << std::endl;
+		for (auto const& [TheBlueToothAddress, MRTGLog] : AddressTemperatureMap)
+			GenerateCacheFile(TheBlueToothAddress, MRTGLog);
+	}
+}
+// Replays the journal that follows a cache file. Replay stops at the first damaged record, and the journal is truncated there so appends can continue.
+template <typename T> void ReadCacheJournal(const std::filesystem::path& CacheFileName, const uint32_t CacheChecksum, std::vector<T>& MRTGLog, MRTGJournal& Journal)
+{
+	std::filesystem::path MRTGJournalFile(GenerateJournalFileName(CacheFileName));
+	int JournalFile = open(MRTGJournalFile.c_str(), O_RDWR | O_CLOEXEC);
+	struct stat64 JournalStat({ 0 });
+	if ((JournalFile >= 0) && (0 == fstat64(JournalFile, &JournalStat)))
+	{
+		MRTGCacheHeader Header({ 0 });
+		if ((sizeof(Header) == read(JournalFile, &Header, sizeof(Header))) &&
+			CacheHeaderMatches<T>(Header, MRTG_JOURNAL_MAGIC) &&
+			(Header.Checksum == CacheChecksum))
+		{
+			std::string Buffer(JournalStat.st_size - sizeof(Header), '\0');
+			if (ssize_t(Buffer.size()) == read(JournalFile, Buffer.data(), Buffer.size()))
+			{
+				size_t Offset = 0;
+				size_t Records = 0;
+				bool bValid = true;
+				while (bValid && ((Offset + sizeof(MRTGJournalRecord) + sizeof(T)) <= Buffer.size()))
+				{
+					MRTGJournalRecord Record;
+					T TheValue;
+					memcpy(&Record, Buffer.data() + Offset, sizeof(Record));
+					memcpy(static_cast<void*>(&TheValue), Buffer.data() + Offset + sizeof(Record), sizeof(T));
+					bValid = (Record.Kind < 6) && (Record.Checksum == JournalRecordChecksum(Record.Kind, TheValue));
+					if (bValid)
+					{
+						ReplayJournalRecord(MRTGLog, Record.Kind, TheValue);
+						Offset += sizeof(Record) + sizeof(T);
+						Records++;
+					}
+				}
+				if (Offset < Buffer.size())
+					std::cerr << "[" << getTimeISO8601(true) << "] Discarding " << Buffer.size() - Offset << " damaged bytes at the end of " << MRTGJournalFile.native() << std::endl;
+				if (ConsoleVerbosity > 0)
+					std::cout << "[" << getTimeISO8601(true) << "] Replayed " << Records << " records from " << MRTGJournalFile.native() << std::endl;
+				if (0 == ftruncate(JournalFile, sizeof(Header) + Offset))	// if this fails, Journal.Size stays zero and the cache file is rewritten instead
+				{
+					Journal.CacheChecksum = CacheChecksum;
+					Journal.Size = sizeof(Header) + Offset;
+					Journal.Time = MRTGLog[0].Time;
+				}
+			}
+		}
+	}
+	if (JournalFile >= 0)
+		close(JournalFile);
+}
+// Loads the samples of a binary cache file with a single read after checking the header and file size, then verifies the checksum and replays the journal.
+template <typename T> bool ReadCacheFile(const std::filesystem::path& CacheFileName, const int CacheFile, const off_t FileSize, std::map<bdaddr_t, std::vector<T>>& MRTGLogs)
+{
+	bool rval = false;
+	MRTGCacheHeader Header({ 0 });
+	if ((sizeof(Header) == read(CacheFile, &Header, sizeof(Header))) &&
+		CacheHeaderMatches<T>(Header, MRTG_CACHE_MAGIC) &&
+		(Header.RecordCount == (2 + DAY_COUNT + WEEK_COUNT + MONTH_COUNT + YEAR_COUNT)) &&
+		(FileSize == off_t(sizeof(Header) + Header.RecordCount * sizeof(T))))
+	{
+		std::vector<T> FakeMRTGFile(Header.RecordCount);
+		const ssize_t Length(Header.RecordCount * sizeof(T));
+		if ((Length == read(CacheFile, FakeMRTGFile.data(), Length)) &&
+			(Header.Checksum == crc32(crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef*>(FakeMRTGFile.data()), Length)))
+		{
+			bdaddr_t TheBlueToothAddress({ 0 });
+			memcpy(TheBlueToothAddress.b, Header.Address, sizeof(Header.Address));
+			ReadCacheJournal(CacheFileName, Header.Checksum, FakeMRTGFile, MRTGJournals[TheBlueToothAddress]);
+			auto foo = GoveeThermometers.find(TheBlueToothAddress);
+			if (foo != GoveeThermometers.end())
+				for (auto& TheValue : FakeMRTGFile)
+					if (TheValue.GetModel() == ThermometerType::Unknown)
+						TheValue.SetModel(foo->second);
+			MRTGLogs.insert(std::pair<bdaddr_t, std::vector<T>>(TheBlueToothAddress, FakeMRTGFile));
+			rval = true;
+		}
+	}
+	return(rval);
+}
+void ReadCacheDirectory(void)
+{
+	const std::regex CacheFileRegex("^(gvh-|ruuvi-)[[:xdigit:]]{12}-cache.(bin|txt)");
+	if (!CacheDirectory.empty())
+	{
+		if (ConsoleVerbosity > 1)
+			std::cout << "[" << getTimeISO8601(true) << "] ReadCacheDirectory: " << CacheDirectory << std::endl;
+		std::deque<std::filesystem::path> files;
+		for (auto const& dir_entry : std::filesystem::directory_iterator{ CacheDirectory })
+			if (dir_entry.is_regular_file())
+				if (std::regex_match(dir_entry.path().filename().string(), CacheFileRegex))
+					files.push_back(dir_entry);
+		if (!files.empty())
+		{
+			sort(files.begin(), files.end());	// a device's -cache.bin sorts ahead of an older -cache.txt, which is then ignored
+			while (!files.empty())
+			{
+				const bool bRuuviCache = (0 == files.begin()->filename().string().compare(0, 6, "ruuvi-"));
+				const bdaddr_t CacheAddress(string2ba(files.begin()->stem().string().substr(bRuuviCache ? 6 : 4, 12)));
+				if (files.begin()->extension() == ".bin")
+				{
+					int CacheFile = open(files.begin()->c_str(), O_RDONLY | O_CLOEXEC);
+					struct stat64 CacheStat({ 0 });
+					if ((CacheFile >= 0) && (0 == fstat64(CacheFile, &CacheStat)))
+					{
+						if (ConsoleVerbosity > 0)
+							std::cout << "[" << getTimeISO8601(true) << "] Reading: " << files.begin()->string() << std::endl;
+						else
+							std::cerr << "Reading: " << files.begin()->string() << std::endl;
+						bool bValid = bRuuviCache ? ReadCacheFile(*files.begin(), CacheFile, CacheStat.st_size, RuuviMRTGLogs) : ReadCacheFile(*files.begin(), CacheFile, CacheStat.st_size, GoveeMRTGLogs);
+						if (!bValid)
+							std::cerr << "[" << getTimeISO8601(true) << "] Ignoring incompatible or damaged cache file: " << files.begin()->string() << std::endl;
+					}
+					if (CacheFile >= 0)
+						close(CacheFile);
+				}
+				else if (bRuuviCache ? (RuuviMRTGLogs.count(CacheAddress) == 0) : (GoveeMRTGLogs.count(CacheAddress) == 0))	// text cache from an earlier version, only used if the device had no binary cache
+				{
+					std::ifstream TheFile(*files.begin());
+					if (TheFile.is_open())
+					{
+						if (ConsoleVerbosity > 0)
+							std::cout << "[" << getTimeISO8601(true) << "] Reading: " << files.begin()->string() << std::endl;
+						else
+							std::cerr << "Reading: " << files.begin()->string() << std::endl;
+						std::string TheLine;
+						if (std::getline(TheFile, TheLine))
+						{
+							const std::regex CacheFirstLineRegex("^Cache: ((([[:xdigit:]]{2}:){5}))[[:xdigit:]]{2}.*");
+							// every Cache File should have a start line with the name Cache, the Bluetooth Address, and the creator version. 
+							// TODO: check to make sure the version is compatible
+							if (std::regex_match(TheLine, CacheFirstLineRegex))
+							{
+								std::smatch BluetoothAddress;
+								if (std::regex_search(TheLine, BluetoothAddress, BluetoothAddressRegex))
+								{
+									bdaddr_t TheBlueToothAddress(string2ba(BluetoothAddress.str()));
+									const std::regex GoveeCacheFileRegex("^gvh-[[:xdigit:]]{12}-cache.txt");
+									const std::regex RuuviCacheFileRegex("^ruuvi-[[:xdigit:]]{12}-cache.txt");
+									if (std::regex_match(files.begin()->filename().string(), GoveeCacheFileRegex))
+									{
+										ThermometerType CacheThermometerType = ThermometerType::Unknown;
+										auto foo = GoveeThermometers.find(TheBlueToothAddress);
+										if (foo != GoveeThermometers.end())
+											CacheThermometerType = foo->second;
+										std::vector<Govee_Temp> FakeMRTGFile;
+										FakeMRTGFile.reserve(2 + DAY_COUNT + WEEK_COUNT + MONTH_COUNT + YEAR_COUNT); // this might speed things up slightly
+										while (std::getline(TheFile, TheLine))
+										{
+											Govee_Temp TheValue;
+											TheValue.ReadCache(TheLine);
+											if (TheValue.GetModel() == ThermometerType::Unknown)
+												TheValue.SetModel(CacheThermometerType);
+											FakeMRTGFile.push_back(TheValue);
+										}
+										if (FakeMRTGFile.size() == (2 + DAY_COUNT + WEEK_COUNT + MONTH_COUNT + YEAR_COUNT)) // simple check to see if we are the right size
+											GoveeMRTGLogs.insert(std::pair<bdaddr_t, std::vector<Govee_Temp>>(TheBlueToothAddress, FakeMRTGFile));
+									}
+									else if (std::regex_match(files.begin()->filename().string(), RuuviCacheFileRegex))
+									{
+										std::vector<Ruuvi_Tag> FakeMRTGFile;
+										FakeMRTGFile.reserve(2 + DAY_COUNT + WEEK_COUNT + MONTH_COUNT + YEAR_COUNT); // this might speed things up slightly
+										while (std::getline(TheFile, TheLine))
+										{
+											Ruuvi_Tag TheValue;
+											TheValue.ReadCache(TheLine);
+											FakeMRTGFile.push_back(TheValue);
+										}
+										if (FakeMRTGFile.size() == (2 + DAY_COUNT + WEEK_COUNT + MONTH_COUNT + YEAR_COUNT)) // simple check to see if we are the right size
+											RuuviMRTGLogs.insert(std::pair<bdaddr_t, std::vector<Ruuvi_Tag>>(TheBlueToothAddress, FakeMRTGFile));
+									}
+								}
+							}
+						}
+						TheFile.close();
+					}
+				}
+				files.pop_front();
+			}
+		}
+	}
+}
+/////////////////////////////////////////////////////////////////////////////
+enum class GraphType { daily, weekly, monthly, yearly};
+// Returns a curated vector of data points specific to the requested graph type read directly from a real MRTG log file on disk.
+void ReadMRTGData(const std::filesystem::path& MRTGLogFileName, std::vector<Govee_Temp>& TheValues, const GraphType graph = GraphType::daily)
+{
+	std::ifstream TheInFile(MRTGLogFileName);
+	if (TheInFile.is_open())
+	{
+		TheValues.clear();
+		std::string Line;
+		while (std::getline(TheInFile, Line))
+		{
+			std::stringstream Source(Line);
 			time_t tim;
 			double tem;
 			double hum;
@@ -1989,776 +3156,2475 @@ void ReadMRTGData(const std::filesystem::path& MRTGLogFileName, std::vector<Gove
 			Govee_Temp TheValue(tim, tem, hum, 0);
 			TheValues.push_back(TheValue);
 		}
-		TheInFile.close();
-		if (graph == GraphType::daily)
+		TheInFile.close();
+		if (graph == GraphType::daily)
+		{
+			TheValues.resize(603); // get rid of anything beyond the five minute data
+			TheValues.erase(TheValues.begin()); // get rid of the first element
+		}
+		else if (graph == GraphType::weekly)
+		{
+			TheValues.erase(TheValues.begin()); // get rid of the first element
+			std::vector<Govee_Temp> TempValues;
+			for (auto iter = TheValues.begin(); iter != TheValues.end(); iter++)
+			{
+				struct tm UTC;
+				if (0 != gmtime_r(&iter->Time, &UTC))
+				{
+					if ((UTC.tm_min == 0) || (UTC.tm_min == 30))
+						TempValues.push_back(*iter);
+				}
+			}
+			TheValues.resize(TempValues.size());
+			std::copy(TempValues.begin(), TempValues.end(), TheValues.begin());
+		}
+		else if (graph == GraphType::monthly)
+		{
+			TheValues.erase(TheValues.begin()); // get rid of the first element
+			std::vector<Govee_Temp> TempValues;
+			for (auto iter = TheValues.begin(); iter != TheValues.end(); iter++)
+			{
+				struct tm UTC;
+				if (0 != gmtime_r(&iter->Time, &UTC))
+				{
+					if ((UTC.tm_hour % 2 == 0) && (UTC.tm_min == 0))
+						TempValues.push_back(*iter);
+				}
+			}
+			TheValues.resize(TempValues.size());
+			std::copy(TempValues.begin(), TempValues.end(), TheValues.begin());
+		}
+		else if (graph == GraphType::yearly)
+		{
+			TheValues.erase(TheValues.begin()); // get rid of the first element
+			std::vector<Govee_Temp> TempValues;
+			for (auto iter = TheValues.begin(); iter != TheValues.end(); iter++)
+			{
+				struct tm UTC;
+				if (0 != gmtime_r(&iter->Time, &UTC))
+				{
+					if ((UTC.tm_hour == 0) && (UTC.tm_min == 0))
+						TempValues.push_back(*iter);
+				}
+			}
+			TheValues.resize(TempValues.size());
+			std::copy(TempValues.begin(), TempValues.end(), TheValues.begin());
+		}
+	}
+}
+// The samples of one tier of the internal memory structure that fakes the structure of a real MRTG log file on disk, newest first, without copying them.
+// Only the valid samples at the start of the tier are included, and the view is only good until the memory structure is next updated.
+template <typename T> class MRTGTier {
+public:
+	MRTGTier(const std::vector<T>& MRTGLog, const GraphType graph);
+	explicit MRTGTier(const std::vector<T>& TheValues);	// all of a vector already holding curated samples
+	bool empty(void) const { return(Count == 0); };
+	std::size_t size(void) const { return(Count); };
+	const T& operator[](const std::size_t index) const { return(Data[index]); };
+	time_t Time(const std::size_t index) const { return((index == 0) ? FirstTime : Data[index].Time); };
+	void CopyTo(std::vector<T>& TheValues) const;	// for data that has to outlive the next update, as it does for the SVG worker threads
+private:
+	const T* Data;
+	std::size_t Count;
+	time_t FirstTime;	// the day graph is labeled with the time of the most recent reading instead of its newest sample
+};
+template <typename T> MRTGTier<T>::MRTGTier(const std::vector<T>& MRTGLog, const GraphType graph) : Data(NULL), Count(0), FirstTime(0)
+{
+	if (!MRTGLog.empty())
+	{
+		const int Tier(static_cast<int>(graph));
+		Data = MRTGLog.data() + MRTG_TIER_FIRST[Tier];
+		while ((Count < MRTG_TIER_COUNT[Tier] - 1) && Data[Count].IsValid())	// the oldest sample of each tier has never been drawn
+			Count++;
+		if (Count > 0)
+			FirstTime = (graph == GraphType::daily) ? MRTGLog[0].Time : Data[0].Time;
+	}
+}
+template <typename T> MRTGTier<T>::MRTGTier(const std::vector<T>& TheValues) : Data(TheValues.data()), Count(TheValues.size()), FirstTime(TheValues.empty() ? 0 : TheValues[0].Time)
+{
+}
+template <typename T> void MRTGTier<T>::CopyTo(std::vector<T>& TheValues) const
+{
+	TheValues.assign(Data, Data + Count);
+	if (!TheValues.empty())
+		TheValues[0].Time = FirstTime;
+}
+// Interesting ideas about SVG and possible tools to look at: https://blog.usejournal.com/of-svg-minification-and-gzip-21cd26a5d007
+// Tools Mentioned: svgo gzthermal https://github.com/subzey/svg-gz-supplement/
+// Writes the points of a polyline or polygon, leaving out each point that lies on the straight line from the point before it to the point after it.
+// The graphs have one sample per pixel column and round the values to whole pixels, so steady readings make long straight runs and the shape drawn doesn't change.
+class SVGPoints {
+public:
+	SVGPoints(FormatBuffer& TheFile) : SVGFile(TheFile), Written(0), bHeld(false), LastX(0), LastY(0), HeldX(0), HeldY(0) { };
+	void Add(const int x, const int y);
+	void Flush(void);
+private:
+	FormatBuffer& SVGFile;
+	size_t Written;
+	bool bHeld;	// the most recent point isn't written until we know whether the next one continues its line
+	int LastX, LastY, HeldX, HeldY;
+	void Write(const int x, const int y);
+};
+void SVGPoints::Write(const int x, const int y)
+{
+	if (Written > 0)
+		SVGFile << " ";
+	SVGFile << x << "," << y;
+	Written++;
+	LastX = x;
+	LastY = y;
+}
+void SVGPoints::Add(const int x, const int y)
+{
+	if (Written == 0)
+		Write(x, y);
+	else if (!bHeld)
+	{
+		HeldX = x;
+		HeldY = y;
+		bHeld = true;
+	}
+	else
+	{
+		// Same direction, not only the same line, so the turn at the end of a min/max polygon is kept.
+		const bool bStraight = ((HeldX - LastX) * (y - HeldY) == (HeldY - LastY) * (x - HeldX)) && ((HeldX - LastX) * (x - HeldX) + (HeldY - LastY) * (y - HeldY) > 0);
+		if (!bStraight)
+			Write(HeldX, HeldY);
+		HeldX = x;
+		HeldY = y;
+	}
+}
+void SVGPoints::Flush(void)
+{
+	if (bHeld)
+		Write(HeldX, HeldY);
+	bHeld = false;
+}
+// The parts of a graph that only depend on where the graph region sits: the header and style block, the frame, the axis lines and the start of each axis label.
+// There are only a few layouts, depending on which legends are drawn, so each is built once and the graphs only write the data, the values and the time labels themselves.
+struct SVGChrome
+{
+	std::string Head;	// up to the style that depends on the pressure range
+	std::string StyleEnd;
+	std::string Frame;
+	std::string TitleText;	// each text up to its contents
+	std::string TimeText;
+	std::string Lines[5];	// top, the three dashed divisions, bottom
+	std::string TempLabel[5];
+	std::string HumiLabel[5];
+	std::string PressureLabel[5];
+	std::string Sides;
+	std::string Arrow;
+};
+typedef std::tuple<std::size_t, std::size_t, std::size_t, std::size_t, int, int, int, int> SVGLayout;
+std::mutex SVGChromeMutex;	// graphs are also drawn on the SVG worker threads
+std::map<SVGLayout, SVGChrome> SVGChromes;	// entries are never removed, so references stay valid without holding the lock
+const SVGChrome& GetSVGChrome(const std::size_t SVGWidth, const std::size_t SVGHeight, const std::size_t FontSize, const std::size_t TickSize, const int GraphLeft, const int GraphRight, const int GraphTop, const int GraphBottom)
+{
+	std::lock_guard<std::mutex> Lock(SVGChromeMutex);
+	auto Inserted = SVGChromes.insert(std::make_pair(SVGLayout(SVGWidth, SVGHeight, FontSize, TickSize, GraphLeft, GraphRight, GraphTop, GraphBottom), SVGChrome()));
+	SVGChrome& Chrome(Inserted.first->second);
+	if (Inserted.second)
+	{
+		FormatBuffer Text;
+		Text << "<?xml version=\"1.0\" encoding=\"utf-8\" standalone=\"no\"?>\n";
+		Text << "<svg xmlns=\"http://www.w3.org/2000/svg\" xmlns:xlink=\"http://www.w3.org/1999/xlink\" width=\"" << SVGWidth << "\" height=\"" << SVGHeight << "\">\n";
+		Text << "\t<!-- Created by: " << ProgramVersionString << " -->\n";
+		Text << "\t<clipPath id=\"GraphRegion\"><polygon points=\"" << GraphLeft << "," << GraphTop << " " << GraphRight << "," << GraphTop << " " << GraphRight << "," << GraphBottom << " " << GraphLeft << "," << GraphBottom << "\" /></clipPath>\n";
+		Text << "\t<style>\n";
+		Text << "\t\ttext { font-family: sans-serif; font-size: " << FontSize << "px; fill: dimgrey; }\n";
+		Text << "\t\tline { stroke: dimgrey; }\n";
+		Text << "\t\tpolygon { fill-opacity: 0.5; }\n";
+		Chrome.Head = Text.str();
+		Text.clear();
+#ifdef _DARK_STYLE_
+		Text << "\t@media only screen and (prefers-color-scheme: dark) {\n";
+		Text << "\t\ttext { fill: grey; }\n";
+		Text << "\t\tline { stroke: grey; }\n";
+		Text << "\t}\n";
+#endif // _DARK_STYLE_
+		Text << "\t</style>\n";
+		Chrome.StyleEnd = Text.str();
+		Text.clear();
+		Text << "\t<rect style=\"fill-opacity:0;stroke:grey;stroke-width:2\" width=\"" << SVGWidth << "\" height=\"" << SVGHeight << "\" />\n";
+		Chrome.Frame = Text.str();
+		Text.clear();
+		Text << "\t<text x=\"" << GraphLeft << "\" y=\"" << GraphTop - 2 << "\">";
+		Chrome.TitleText = Text.str();
+		Text.clear();
+		Text << "\t<text style=\"text-anchor:end\" x=\"" << GraphRight << "\" y=\"" << GraphTop - 2 << "\">";
+		Chrome.TimeText = Text.str();
+		const int GraphVerticalDivision = (GraphBottom - GraphTop) / 4;
+		for (auto index = 0; index < 5; index++)
+		{
+			const int y = (index == 4) ? GraphBottom : GraphTop + (GraphVerticalDivision * index);
+			Text.clear();
+			if ((index == 0) || (index == 4))
+				Text << "\t<line x1=\"" << GraphLeft - TickSize << "\" y1=\"" << y << "\" x2=\"" << GraphRight + TickSize << "\" y2=\"" << y << "\"/>\n";
+			else
+				Text << "\t<line style=\"stroke-dasharray:1\" x1=\"" << GraphLeft - TickSize << "\" y1=\"" << y << "\" x2=\"" << GraphRight + TickSize << "\" y2=\"" << y << "\" />\n";
+			Chrome.Lines[index] = Text.str();
+			Text.clear();
+			Text << "\t<text style=\"fill:blue;text-anchor:end;dominant-baseline:middle\" x=\"" << GraphLeft - TickSize << "\" y=\"" << y << "\">";
+			Chrome.TempLabel[index] = Text.str();
+			Text.clear();
+			Text << "\t<text style=\"fill:green;dominant-baseline:middle\" x=\"" << GraphRight + TickSize << "\" y=\"" << y << "\">";
+			Chrome.HumiLabel[index] = Text.str();
+			Text.clear();
+			Text << "\t<text style=\"fill:purple;text-anchor:end;dominant-baseline:middle\" x=\"" << GraphRight + TickSize << "\" y=\"" << y << "\">";
+			Chrome.PressureLabel[index] = Text.str();
+		}
+		Text.clear();
+		Text << "\t<line x1=\"" << GraphLeft << "\" y1=\"" << GraphTop << "\" x2=\"" << GraphLeft << "\" y2=\"" << GraphBottom << "\"/>\n";
+		Text << "\t<line x1=\"" << GraphRight << "\" y1=\"" << GraphTop << "\" x2=\"" << GraphRight << "\" y2=\"" << GraphBottom << "\"/>\n";
+		Chrome.Sides = Text.str();
+		Text.clear();
+		Text << "\t<polygon style=\"fill:red;stroke:red;fill-opacity:1;\" points=\"" << GraphLeft - 3 << "," << GraphBottom << " " << GraphLeft + 3 << "," << GraphBottom - 3 << " " << GraphLeft + 3 << "," << GraphBottom + 3 << "\" />\n";
+		Chrome.Arrow = Text.str();
+	}
+	return(Chrome);
+}
+const size_t SVG_RESERVE(32 * 1024);	// a graph with min/max bands drawn from noisy data is around 15KB
+// The range of each measurement over the samples a graph shows, in the units the samples hold them, without and with each sample's minimum and maximum.
+struct SVGAxisRange
+{
+	double Min = DBL_MAX;
+	double Max = -DBL_MAX;
+	void Add(const double Value) { Min = std::min(Min, Value); Max = std::max(Max, Value); };
+};
+struct SVGRanges
+{
+	std::size_t Count = 0;	// samples looked at
+	SVGAxisRange Temperature[2];	// Celsius. Fahrenheit only scales and offsets it, so the same samples are the lowest and highest.
+	SVGAxisRange Humidity[2];
+	SVGAxisRange Pressure[2];
+};
+template <typename T> void GetSVGRanges(const MRTGTier<T>& TheValues, const std::size_t Count, SVGRanges& Ranges)
+{
+	Ranges = SVGRanges();
+	Ranges.Count = Count;
+	for (auto index = std::size_t(0); index < Count; index++)
+	{
+		const T& Sample(TheValues[index]);
+		Ranges.Temperature[0].Add(Sample.GetTemperature());
+		Ranges.Temperature[1].Add(Sample.GetTemperatureMin());
+		Ranges.Temperature[1].Add(Sample.GetTemperatureMax());
+		Ranges.Humidity[0].Add(Sample.GetHumidity());
+		Ranges.Humidity[1].Add(Sample.GetHumidityMin());
+		Ranges.Humidity[1].Add(Sample.GetHumidityMax());
+		Ranges.Pressure[0].Add(Sample.GetPressure());
+		Ranges.Pressure[1].Add(Sample.GetPressureMin());
+		Ranges.Pressure[1].Add(Sample.GetPressureMax());
+	}
+}
+// Takes the data points for a specific graph type and draws it as SVG text.
+// Ranges can be shared by the variants drawn from the same samples, and is only worked out again when a variant shows a different number of them.
+template <typename T> void WriteSVG(const MRTGTier<T>& TheValues, SVGRanges& Ranges, FormatBuffer& SVGFile, const std::string& Title, const GraphType graph, const SVGVariant& Variant)
+{
+	if (!TheValues.empty())
+	{
+		const bool Fahrenheit(Variant.Fahrenheit);
+		const bool DrawBattery(Variant.Battery & (1 << static_cast<int>(graph)));
+		const bool MinMax(Variant.MinMax & (1 << static_cast<int>(graph)));
+		// By declaring these items here, I'm then basing all my other dimensions on these
+		const std::size_t SVGWidth(Variant.Width);
+		const std::size_t SVGHeight(Variant.Height);
+		const std::size_t FontSize(12);
+		const std::size_t TickSize(2);
+		std::size_t GraphWidth = SVGWidth - (FontSize * 5);
+		FormatBuffer tempOString;
+		tempOString << "Temperature (" << FormatFixed(TheValues[0].GetTemperature(Fahrenheit), 1) << "\u00B0" << (Fahrenheit ? "F)" : "C)");
+		const std::string YLegendTemperature(tempOString.str());
+		tempOString.clear();
+		tempOString << "Humidity (" << FormatFixed(TheValues[0].GetHumidity(), 1) << "%)";
+		const std::string YLegendHumidity(tempOString.str());
+		tempOString.clear();
+		// The RuuviTag battery is a voltage and was always written with the one decimal place the humidity left on the stream
+		if (std::is_floating_point<decltype(TheValues[0].GetBattery())>::value)
+			tempOString << "Battery (" << FormatFixed(TheValues[0].GetBattery(), 1) << "%)";
+		else
+			tempOString << "Battery (" << TheValues[0].GetBattery() << "%)";
+		const std::string YLegendBattery(tempOString.str());
+		tempOString.clear();
+		tempOString << "Pressure (" << FormatFixed(TheValues[0].GetPressure(), 1) << " hPa)";
+		const std::string YLegendPressure(tempOString.str());
+		int GraphTop = FontSize + TickSize;
+		int GraphBottom = SVGHeight - GraphTop;
+		int GraphRight = SVGWidth - GraphTop;
+		const std::size_t RangeCount(GraphWidth < TheValues.size() ? GraphWidth : TheValues.size());
+		if (Ranges.Count != RangeCount)
+			GetSVGRanges(TheValues, RangeCount, Ranges);
+		double TempMin = Ranges.Temperature[MinMax ? 1 : 0].Min;
+		double TempMax = Ranges.Temperature[MinMax ? 1 : 0].Max;
+		if (Fahrenheit)
+		{
+			TempMin = (TempMin * 9.0 / 5.0) + 32.0;
+			TempMax = (TempMax * 9.0 / 5.0) + 32.0;
+		}
+		const double HumiMin = Ranges.Humidity[MinMax ? 1 : 0].Min;
+		const double HumiMax = Ranges.Humidity[MinMax ? 1 : 0].Max;
+		const double PressureMin = Ranges.Pressure[MinMax ? 1 : 0].Min;
+		const double PressureMax = Ranges.Pressure[MinMax ? 1 : 0].Max;
+		const bool DrawHumidity = (HumiMax - HumiMin) > 0.1;
+		if (DrawHumidity)
+		{
+			GraphWidth -= FontSize * 2;
+			GraphRight -= FontSize + TickSize * 2;
+		}
+		if (DrawBattery)
+			GraphWidth -= FontSize;
+		const double MinPressureDifferential = 4.0;
+		const bool DrawPressure = PressureMax - PressureMin > MinPressureDifferential;
+		if (DrawPressure)
+		{
+			// Space for legend to be drawn on the right of the graph plus space for one more legend line on the left.
+			GraphWidth -= FontSize;
+			// I took the next line out because I'm drawing pressure ledgend over the graph surface instead of to the right of the graph, so I don't need to make extra space on the right side of the graph for the legend. This also allows me to use more of the graph surface for drawing the pressure line which is helpful because the pressure differential is often small and can be hard to see if I don't use as much of the graph surface as possible.
+			//GraphRight -= FontSize + TickSize * 2;
+		}
+		int GraphLeft = GraphRight - GraphWidth;
+		const SVGChrome& Chrome(GetSVGChrome(SVGWidth, SVGHeight, FontSize, TickSize, GraphLeft, GraphRight, GraphTop, GraphBottom));
+
+		const double TempVerticalDivision = (TempMax - TempMin) / 4;
+		const double TempVerticalFactor = (GraphBottom - GraphTop) / (TempMax - TempMin);
+		const double HumiVerticalDivision = (HumiMax - HumiMin) / 4;
+		const double HumiVerticalFactor = (GraphBottom - GraphTop) / (HumiMax - HumiMin);
+		const double PressureVerticalDivision = (PressureMax - PressureMin) / 4;
+		const double PressureVerticalFactor = (GraphBottom - GraphTop) / (PressureMax - PressureMin);
+		int FreezingLine = 0; // outside the range of the graph
+		if (Fahrenheit)
+		{
+			if ((TempMin < 32) && (32 < TempMax))
+				FreezingLine = int(((TempMax - 32.0) * TempVerticalFactor)) + GraphTop;
+		}
+		else
+		{
+			if ((TempMin < 0) && (0 < TempMax))
+				FreezingLine = int((TempMax * TempVerticalFactor)) + GraphTop;
+		}
+
+		SVGFile << Chrome.Head;
+		if (DrawPressure)
+			SVGFile << "\t\t.barometer-label { font-family: Georgia, serif; font-style: italic; font-size: " << int(PressureVerticalFactor * 10) << "px; opacity: 0.5; clip-path: url(#GraphRegion); text-anchor: middle; dominant-baseline: middle; }\n";
+		SVGFile << Chrome.StyleEnd;
+#ifdef DEBUG
+		SVGFile << "<!-- HumiMax: " << HumiMax << " -->\n";
+		SVGFile << "<!-- HumiMin: " << HumiMin << " -->\n";
+		SVGFile << "<!-- HumiVerticalFactor: " << HumiVerticalFactor << " -->\n";
+#endif // DEBUG
+		SVGFile << Chrome.Frame;
+
+		// Legend Text
+		int LegendIndex = 1;
+		SVGFile << Chrome.TitleText << Title << "</text>\n";
+		SVGFile << Chrome.TimeText << timeToExcelLocal(TheValues.Time(0)) << "</text>\n";
+		SVGFile << "\t<text style=\"fill:blue;text-anchor:middle\" x=\"" << FontSize * LegendIndex << "\" y=\"50%\" transform=\"rotate(270 " << FontSize * LegendIndex << "," << (GraphTop + GraphBottom) / 2 << ")\">" << YLegendTemperature << "</text>\n";
+		if (DrawHumidity)
+		{
+			LegendIndex++;
+			SVGFile << "\t<text style=\"fill:green;text-anchor:middle\" x=\"" << FontSize * LegendIndex << "\" y=\"50%\" transform=\"rotate(270 " << FontSize * LegendIndex << "," << (GraphTop + GraphBottom) / 2 << ")\">" << YLegendHumidity << "</text>\n";
+		}
+		if (DrawPressure)
+		{
+			LegendIndex++;
+			SVGFile << "\t<text style=\"fill:purple;text-anchor:middle\" x=\"" << FontSize * LegendIndex << "\" y=\"50%\" transform=\"rotate(270 " << FontSize * LegendIndex << "," << (GraphTop + GraphBottom) / 2 << ")\">" << YLegendPressure << "</text>\n";
+		}
+		if (DrawBattery)
+		{
+			LegendIndex++;
+			SVGFile << "\t<text style=\"fill:OrangeRed\" text-anchor=\"middle\" x=\"" << FontSize * LegendIndex << "\" y=\"50%\" transform=\"rotate(270 " << FontSize * LegendIndex << "," << (GraphTop + GraphBottom) / 2 << ")\">" << YLegendBattery << "</text>\n";
+		}
+		if (DrawHumidity)
+		{
+			if (MinMax)
+			{
+				SVGFile << "\t<!-- Humidity Max -->\n";
+				SVGFile << "\t<polygon style=\"fill:lime;stroke:green;clip-path:url(#GraphRegion)\" points=\"";
+				SVGPoints HumiMaxPoints(SVGFile);
+				HumiMaxPoints.Add(GraphLeft + 1, GraphBottom - 1);
+				for (auto index = std::size_t(0); index < (GraphWidth < TheValues.size() ? GraphWidth : TheValues.size()); index++)
+					HumiMaxPoints.Add(int(index + GraphLeft), int(((HumiMax - TheValues[index].GetHumidityMax()) * HumiVerticalFactor) + GraphTop));
+				if (GraphWidth < TheValues.size())
+					HumiMaxPoints.Add(GraphRight - 1, GraphBottom - 1);
+				else
+					HumiMaxPoints.Add(int(GraphRight - (GraphWidth - TheValues.size())), GraphBottom - 1);
+				HumiMaxPoints.Flush();
+				SVGFile << "\" />\n";
+				SVGFile << "\t<!-- Humidity Min -->\n";
+				SVGFile << "\t<polygon style=\"fill:lime;stroke:green;clip-path:url(#GraphRegion)\" points=\"";
+				SVGPoints HumiMinPoints(SVGFile);
+				HumiMinPoints.Add(GraphLeft + 1, GraphBottom - 1);
+				for (auto index = std::size_t(0); index < (GraphWidth < TheValues.size() ? GraphWidth : TheValues.size()); index++)
+					HumiMinPoints.Add(int(index + GraphLeft), int(((HumiMax - TheValues[index].GetHumidityMin()) * HumiVerticalFactor) + GraphTop));
+				if (GraphWidth < TheValues.size())
+					HumiMinPoints.Add(GraphRight - 1, GraphBottom - 1);
+				else
+					HumiMinPoints.Add(int(GraphRight - (GraphWidth - TheValues.size())), GraphBottom - 1);
+				HumiMinPoints.Flush();
+				SVGFile << "\" />\n";
+			}
+			else
+			{
+				// Humidity Graphic as a Filled polygon
+				SVGFile << "\t<!-- Humidity -->\n";
+				SVGFile << "\t<polygon style=\"fill:lime;stroke:green;clip-path:url(#GraphRegion)\" points=\"";
+				SVGPoints Points(SVGFile);
+				Points.Add(GraphLeft + 1, GraphBottom - 1);
+				for (auto index = std::size_t(0); index < (GraphWidth < TheValues.size() ? GraphWidth : TheValues.size()); index++)
+					Points.Add(int(index + GraphLeft), int(((HumiMax - TheValues[index].GetHumidity()) * HumiVerticalFactor) + GraphTop));
+				if (GraphWidth < TheValues.size())
+					Points.Add(GraphRight - 1, GraphBottom - 1);
+				else
+					Points.Add(int(GraphRight - (GraphWidth - TheValues.size())), GraphBottom - 1);
+				Points.Flush();
+				SVGFile << "\" />\n";
+			}
+		}
+
+		// Top Line
+		SVGFile << Chrome.Lines[0];
+		SVGFile << Chrome.TempLabel[0] << FormatFixed(TempMax, 1) << "</text>\n";
+		if (DrawHumidity)
+			SVGFile << Chrome.HumiLabel[0] << FormatFixed(HumiMax, 1) << "</text>\n";
+		if (DrawPressure)
+			SVGFile << Chrome.PressureLabel[0] << FormatFixed(PressureMax, 1) << "</text>\n";
+
+		// Bottom Line
+		SVGFile << Chrome.Lines[4];
+		SVGFile << Chrome.TempLabel[4] << FormatFixed(TempMin, 1) << "</text>\n";
+		if (DrawHumidity)
+			SVGFile << Chrome.HumiLabel[4] << FormatFixed(HumiMin, 1) << "</text>\n";
+		if (DrawPressure)
+			SVGFile << Chrome.PressureLabel[4] << FormatFixed(PressureMin, 1) << "</text>\n";
+
+
+		// Left and Right Lines
+		SVGFile << Chrome.Sides;
+
+		// Vertical Division Dashed Lines
+		for (auto index = 1; index < 4; index++)
+		{
+			SVGFile << Chrome.Lines[index];
+			SVGFile << Chrome.TempLabel[index] << FormatFixed(TempMax - (TempVerticalDivision * index), 1) << "</text>\n";
+			if (DrawHumidity)
+				SVGFile << Chrome.HumiLabel[index] << FormatFixed(HumiMax - (HumiVerticalDivision * index), 1) << "</text>\n";
+			if (DrawPressure)
+				SVGFile << Chrome.PressureLabel[index] << FormatFixed(PressureMax - (PressureVerticalDivision * index), 1) << "</text>\n";
+		}
+
+		// Horizontal Line drawn at the freezing point
+		if ((GraphTop < FreezingLine) && (FreezingLine < GraphBottom))
+		{
+			SVGFile << "\t<!-- FreezingLine = " << FreezingLine << " -->\n";
+			SVGFile << "\t<line style=\"fill:red;stroke:red;stroke-dasharray:1\" x1=\"" << GraphLeft - TickSize << "\" y1=\"" << FreezingLine << "\" x2=\"" << GraphRight + TickSize << "\" y2=\"" << FreezingLine << "\" />\n";
+		}
+
+		// Horizontal Division Dashed Lines
+		for (auto index = std::size_t(0); index < (GraphWidth < TheValues.size() ? GraphWidth : TheValues.size()); index++)
+		{
+			const time_t SampleTime(TheValues.Time(index));
+			struct tm UTC;
+			if (0 != localtime_r(&SampleTime, &UTC))
+			{
+				if (graph == GraphType::daily)
+				{
+					if (UTC.tm_min == 0)
+					{
+						if (UTC.tm_hour == 0)
+							SVGFile << "\t<line style=\"stroke:red\" x1=\"" << GraphLeft + index << "\" y1=\"" << GraphTop << "\" x2=\"" << GraphLeft + index << "\" y2=\"" << GraphBottom + TickSize << "\" />\n";
+						else
+							SVGFile << "\t<line style=\"stroke-dasharray:1\" x1=\"" << GraphLeft + index << "\" y1=\"" << GraphTop << "\" x2=\"" << GraphLeft + index << "\" y2=\"" << GraphBottom + TickSize << "\" />\n";
+						if (UTC.tm_hour % 2 == 0)
+							SVGFile << "\t<text style=\"text-anchor:middle\" x=\"" << GraphLeft + index << "\" y=\"" << SVGHeight - 2 << "\">" << UTC.tm_hour << "</text>\n";
+					}
+				}
+				else if (graph == GraphType::weekly)
+				{
+					const std::string Weekday[] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+					if ((UTC.tm_hour == 0) && (UTC.tm_min == 0))
+					{
+						if (UTC.tm_wday == 0)
+							SVGFile << "\t<line style=\"stroke:red\" x1=\"" << GraphLeft + index << "\" y1=\"" << GraphTop << "\" x2=\"" << GraphLeft + index << "\" y2=\"" << GraphBottom + TickSize << "\" />\n";
+						else
+							SVGFile << "\t<line style=\"stroke-dasharray:1\" x1=\"" << GraphLeft + index << "\" y1=\"" << GraphTop << "\" x2=\"" << GraphLeft + index << "\" y2=\"" << GraphBottom + TickSize << "\" />\n";
+					}
+					else if ((UTC.tm_hour == 12) && (UTC.tm_min == 0))
+						SVGFile << "\t<text style=\"text-anchor:middle\" x=\"" << GraphLeft + index << "\" y=\"" << SVGHeight - 2 << "\">" << Weekday[UTC.tm_wday] << "</text>\n";
+				}
+				else if (graph == GraphType::monthly)
+				{
+					if ((UTC.tm_mday == 1) && (UTC.tm_hour == 0) && (UTC.tm_min == 0))
+						SVGFile << "\t<line style=\"stroke:red\" x1=\"" << GraphLeft + index << "\" y1=\"" << GraphTop << "\" x2=\"" << GraphLeft + index << "\" y2=\"" << GraphBottom + TickSize << "\" />\n";
+					if ((UTC.tm_wday == 0) && (UTC.tm_hour == 0) && (UTC.tm_min == 0))
+						SVGFile << "\t<line style=\"stroke-dasharray:1\" x1=\"" << GraphLeft + index << "\" y1=\"" << GraphTop << "\" x2=\"" << GraphLeft + index << "\" y2=\"" << GraphBottom + TickSize << "\" />\n";
+					else if ((UTC.tm_wday == 3) && (UTC.tm_hour == 12) && (UTC.tm_min == 0))
+						SVGFile << "\t<text style=\"text-anchor:middle\" x=\"" << GraphLeft + index << "\" y=\"" << SVGHeight - 2 << "\">Week " << UTC.tm_yday / 7 + 1 << "</text>\n";
+				}
+				else if (graph == GraphType::yearly)
+				{
+					const std::string Month[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+					if ((UTC.tm_yday == 0) && (UTC.tm_mday == 1) && (UTC.tm_hour == 0) && (UTC.tm_min == 0))
+						SVGFile << "\t<line style=\"stroke:red\" x1=\"" << GraphLeft + index << "\" y1=\"" << GraphTop << "\" x2=\"" << GraphLeft + index << "\" y2=\"" << GraphBottom + TickSize << "\" />\n";
+					else if ((UTC.tm_mday == 1) && (UTC.tm_hour == 0) && (UTC.tm_min == 0))
+						SVGFile << "\t<line style=\"stroke-dasharray:1\" x1=\"" << GraphLeft + index << "\" y1=\"" << GraphTop << "\" x2=\"" << GraphLeft + index << "\" y2=\"" << GraphBottom + TickSize << "\" />\n";
+					else if ((UTC.tm_mday == 15) && (UTC.tm_hour == 0) && (UTC.tm_min == 0))
+						SVGFile << "\t<text style=\"text-anchor:middle\" x=\"" << GraphLeft + index << "\" y=\"" << SVGHeight - 2 << "\">" << Month[UTC.tm_mon] << "</text>\n";
+				}
+			}
+		}
+
+		// Directional Arrow
+		SVGFile << Chrome.Arrow;
+
+		if (MinMax)
+		{
+			// Pressure Values as a filled polygon showing the minimum and maximum
+			if (DrawPressure)
+			{
+				SVGFile << "\t<!-- Pressure MinMax -->\n";
+				SVGFile << "\t<polygon style=\"fill:purple;stroke:purple;clip-path:url(#GraphRegion)\" points=\"";
+				SVGPoints Points(SVGFile);
+				for (auto index = 1; index < (GraphWidth < TheValues.size() ? GraphWidth : TheValues.size()); index++)
+					Points.Add(index + GraphLeft, int(((PressureMax - TheValues[index].GetPressureMax()) * PressureVerticalFactor) + GraphTop));
+				for (auto index = (GraphWidth < TheValues.size() ? GraphWidth : TheValues.size()) - 1; index > 0; index--)
+					Points.Add(int(index + GraphLeft), int(((PressureMax - TheValues[index].GetPressureMin()) * PressureVerticalFactor) + GraphTop));
+				Points.Flush();
+				SVGFile << "\" />\n";
+			}
+			// Temperature Values as a filled polygon showing the minimum and maximum
+			SVGFile << "\t<!-- Temperature MinMax -->\n";
+			SVGFile << "\t<polygon style=\"fill:blue;stroke:blue;clip-path:url(#GraphRegion)\" points=\"";
+			SVGPoints Points(SVGFile);
+			for (auto index = std::size_t(1); index < (GraphWidth < TheValues.size() ? GraphWidth : TheValues.size()); index++)
+				Points.Add(int(index + GraphLeft), int(((TempMax - TheValues[index].GetTemperatureMax(Fahrenheit)) * TempVerticalFactor) + GraphTop));
+			for (auto index = (GraphWidth < TheValues.size() ? GraphWidth : TheValues.size()) - 1; index > 0; index--)
+				Points.Add(int(index + GraphLeft), int(((TempMax - TheValues[index].GetTemperatureMin(Fahrenheit)) * TempVerticalFactor) + GraphTop));
+			Points.Flush();
+			SVGFile << "\" />\n";
+		}
+		else
+		{
+			// Pressure Values as a continuous line
+			if (DrawPressure)
+			{
+				SVGFile << "\t<!-- Pressure -->\n";
+				SVGFile << "\t<polyline style=\"fill:none;stroke:purple;clip-path:url(#GraphRegion)\" points=\"";
+				SVGPoints Points(SVGFile);
+				for (auto index = 1; index < (GraphWidth < TheValues.size() ? GraphWidth : TheValues.size()); index++)
+					Points.Add(index + GraphLeft, int(((PressureMax - TheValues[index].GetPressure()) * PressureVerticalFactor) + GraphTop));
+				Points.Flush();
+				SVGFile << "\" />\n";
+			}
+			// Temperature Values as a continuous line
+			SVGFile << "\t<!-- Temperature -->\n";
+			SVGFile << "\t<polyline style=\"fill:none;stroke:blue;clip-path:url(#GraphRegion)\" points=\"";
+			SVGPoints Points(SVGFile);
+			for (auto index = std::size_t(1); index < (GraphWidth < TheValues.size() ? GraphWidth : TheValues.size()); index++)
+				Points.Add(int(index + GraphLeft), int(((TempMax - TheValues[index].GetTemperature(Fahrenheit)) * TempVerticalFactor) + GraphTop));
+			Points.Flush();
+			SVGFile << "\" />\n";
+		}
+
+		// Battery Values as a continuous line
+		if (DrawBattery)
+		{
+			SVGFile << "\t<!-- Battery -->\n";
+			double BatteryVerticalFactor = (GraphBottom - GraphTop) / 100.0;
+			SVGFile << "\t<polyline style=\"fill:none;stroke:OrangeRed;clip-path:url(#GraphRegion)\" points=\"";
+			SVGPoints Points(SVGFile);
+			for (auto index = std::size_t(1); index < (GraphWidth < TheValues.size() ? GraphWidth : TheValues.size()); index++)
+				Points.Add(int(index + GraphLeft), int(((100 - TheValues[index].GetBattery()) * BatteryVerticalFactor) + GraphTop));
+			Points.Flush();
+			SVGFile << "\" />\n";
+		}
+
+		if (DrawPressure)
+			if (graph != GraphType::daily) // this text was way too busy on the daily graph
+			{
+				SVGFile << "\t<text class=\"barometer-label\" x=\"50%\" y=\"" << int(((PressureMax - 974) * PressureVerticalFactor) + GraphTop) << "\">Rain</text>\n";
+				SVGFile << "\t<text class=\"barometer-label\" x=\"50%\" y=\"" << int(((PressureMax - 999) * PressureVerticalFactor) + GraphTop) << "\">Change</text>\n";
+				SVGFile << "\t<text class=\"barometer-label\" x=\"50%\" y=\"" << int(((PressureMax - 1024) * PressureVerticalFactor) + GraphTop) << "\">Fair</text>\n";
+			}
+
+		SVGFile << "</svg>\n";
+	}
+}
+// Takes a curated vector of data points for a specific graph type and writes a SVG file to disk.
+// Only write the file if we have new data. Prints the Writing line when it should be written.
+template <typename T> bool SVGNeedsWriting(const MRTGTier<T>& TheValues, const std::filesystem::path& SVGFileName, const std::string& Title)
+{
+	bool rval = false;
+	struct stat64 SVGStat({0});	// Zero the stat64 structure on allocation
+	if (-1 == stat64(SVGFileName.c_str(), &SVGStat))
+		if (ConsoleVerbosity > 3)
+			std::cout << "[" << getTimeISO8601(true) << "] " << std::strerror(errno) << ": " << SVGFileName << std::endl;
+	if (TheValues.Time(0) > SVGStat.st_mtim.tv_sec)
+	{
+		rval = true;
+		if (ConsoleVerbosity > 0)
+			std::cout << "[" << getTimeISO8601(true) << "] Writing: " << SVGFileName.string() << " With Title: " << Title << std::endl;
+		else
+			std::cerr << "Writing: " << SVGFileName.string() << " With Title: " << Title << std::endl;
+	}
+	return(rval);
+}
+// Rendered in memory and written with one write, so a web server never serves a partly written graph.
+// Only uses its arguments and settings that don't change after startup, so it's also called from the SVG worker threads.
+template <typename T> void ReplaceSVG(const MRTGTier<T>& TheValues, SVGRanges& Ranges, const std::filesystem::path& SVGFileName, const std::string& Title, const GraphType graph, const SVGVariant& Variant)
+{
+	FormatBuffer SVGFile(SVG_RESERVE);
+	WriteSVG(TheValues, Ranges, SVGFile, Title, graph, Variant);
+	const std::string& Contents(SVGFile.str());
+	if (ReplaceFile(SVGFileName, Contents, TheValues.Time(0)))
+	{
+		LoggerStats.SVGFiles++;
+		if (SVGGzip)
+			ReplaceGzipFile(SVGFileName, Contents, TheValues.Time(0));
+	}
+}
+// Takes a Bluetooth address and current datapoint and updates the mapped structure in memory simulating the contents of a MRTG log file.
+template <typename T> void UpdateMRTGData(const bdaddr_t& TheAddress, const T& TheValue, std::map<bdaddr_t, std::vector<T>>& MRTGLogs)
+{
+	if (TheValue.IsValid())	// Sanity Check
+	{
+		std::vector<T> foo;
+		auto ret = MRTGLogs.insert(std::pair<bdaddr_t, std::vector<T>>(TheAddress, foo));
+		std::vector<T>& FakeMRTGFile = ret.first->second;
+		MRTGJournal& Journal(MRTGJournals[TheAddress]);	// counts the samples pushed onto each tier for the next journal write
+		MRTGGeneration& Generation(MRTGGenerations[TheAddress]);
+		if (FakeMRTGFile.empty())
+		{
+			Generation.Tier[0]++;	// the day graph shows the time of the current value
+			Journal = MRTGJournal();	// nothing on disk to append to
+			FakeMRTGFile.resize(2 + DAY_COUNT + WEEK_COUNT + MONTH_COUNT + YEAR_COUNT);
+			FakeMRTGFile[0] = TheValue;	// current value
+			FakeMRTGFile[1] = TheValue;
+			for (auto index = std::size_t(0); index < DAY_COUNT; index++)
+				FakeMRTGFile[index + 2].Time = FakeMRTGFile[index + 1].Time - DAY_SAMPLE;
+			for (auto index = std::size_t(0); index < WEEK_COUNT; index++)
+				FakeMRTGFile[index + 2 + DAY_COUNT].Time = FakeMRTGFile[index + 1 + DAY_COUNT].Time - WEEK_SAMPLE;
+			for (auto index = std::size_t(0); index < MONTH_COUNT; index++)
+				FakeMRTGFile[index + 2 + DAY_COUNT + WEEK_COUNT].Time = FakeMRTGFile[index + 1 + DAY_COUNT + WEEK_COUNT].Time - MONTH_SAMPLE;
+			for (auto index = std::size_t(0); index < YEAR_COUNT; index++)
+				FakeMRTGFile[index + 2 + DAY_COUNT + WEEK_COUNT + MONTH_COUNT].Time = FakeMRTGFile[index + 1 + DAY_COUNT + WEEK_COUNT + MONTH_COUNT].Time - YEAR_SAMPLE;
+		}
+		else
+		{
+			if (TheValue.Time > FakeMRTGFile[0].Time)	// older values, common when logs are replayed or a download is merged, change nothing
+			{
+				Generation.Tier[0]++;	// the day graph shows the time of the current value
+				FakeMRTGFile[0] = TheValue;	// current value
+				FakeMRTGFile[1] += TheValue; // averaged value up to DAY_SAMPLE size
+			}
+		}
+		bool ZeroAccumulator = false;
+		auto DaySampleFirst = FakeMRTGFile.begin() + 2;
+		auto DaySampleLast = FakeMRTGFile.begin() + 1 + DAY_COUNT;
+		auto WeekSampleFirst = FakeMRTGFile.begin() + 2 + DAY_COUNT;
+		auto WeekSampleLast = FakeMRTGFile.begin() + 1 + DAY_COUNT + WEEK_COUNT;
+		auto MonthSampleFirst = FakeMRTGFile.begin() + 2 + DAY_COUNT + WEEK_COUNT;
+		auto MonthSampleLast = FakeMRTGFile.begin() + 1 + DAY_COUNT + WEEK_COUNT + MONTH_COUNT;
+		auto YearSampleFirst = FakeMRTGFile.begin() + 2 + DAY_COUNT + WEEK_COUNT + MONTH_COUNT;
+		auto YearSampleLast = FakeMRTGFile.begin() + 1 + DAY_COUNT + WEEK_COUNT + MONTH_COUNT + YEAR_COUNT;
+		// For every time difference between FakeMRTGFile[1] and FakeMRTGFile[2] that's greater than DAY_SAMPLE we shift that data towards the back.
+		while (difftime(FakeMRTGFile[1].Time, DaySampleFirst->Time) > DAY_SAMPLE)
+		{
+			ZeroAccumulator = true;
+			// shuffle all the day samples toward the end
+			std::copy_backward(DaySampleFirst, DaySampleLast - 1, DaySampleLast);
+			Journal.Pushed[0]++;
+			*DaySampleFirst = FakeMRTGFile[1];
+			DaySampleFirst->NormalizeTime(T::granularity::day);
+			if (difftime(DaySampleFirst->Time, (DaySampleFirst + 1)->Time) > DAY_SAMPLE)
+				DaySampleFirst->Time = (DaySampleFirst + 1)->Time + DAY_SAMPLE;
+			if (DaySampleFirst->GetTimeGranularity() == T::granularity::year)
+			{
+				if (ConsoleVerbosity > 5)
+					std::cout << "[" << getTimeISO8601(true) << "] shuffling year " << timeToExcelLocal(DaySampleFirst->Time) << " > " << timeToExcelLocal(YearSampleFirst->Time) << std::endl;
+				// shuffle all the year samples toward the end
+				std::copy_backward(YearSampleFirst, YearSampleLast - 1, YearSampleLast);
+				Journal.Pushed[3]++;
+				Generation.Tier[3]++;
+				*YearSampleFirst = T();
+				for (auto iter = DaySampleFirst; (iter->IsValid() && ((iter - DaySampleFirst) < (12 * 24))); iter++) // One Day of day samples
+					*YearSampleFirst += *iter;
+			}
+			if ((DaySampleFirst->GetTimeGranularity() == T::granularity::year) ||
+				(DaySampleFirst->GetTimeGranularity() == T::granularity::month))
+			{
+				if (ConsoleVerbosity > 5)
+					std::cout << "[" << getTimeISO8601(true) << "] shuffling month " << timeToExcelLocal(DaySampleFirst->Time) << std::endl;
+				// shuffle all the month samples toward the end
+				std::copy_backward(MonthSampleFirst, MonthSampleLast - 1, MonthSampleLast);
+				Journal.Pushed[2]++;
+				Generation.Tier[2]++;
+				*MonthSampleFirst = T();
+				for (auto iter = DaySampleFirst; (iter->IsValid() && ((iter - DaySampleFirst) < (12 * 2))); iter++) // two hours of day samples
+					*MonthSampleFirst += *iter;
+			}
+			if ((DaySampleFirst->GetTimeGranularity() == T::granularity::year) ||
+				(DaySampleFirst->GetTimeGranularity() == T::granularity::month) ||
+				(DaySampleFirst->GetTimeGranularity() == T::granularity::week))
+			{
+				if (ConsoleVerbosity > 5)
+					std::cout << "[" << getTimeISO8601(true) << "] shuffling week " << timeToExcelLocal(DaySampleFirst->Time) << std::endl;
+				// shuffle all the month samples toward the end
+				std::copy_backward(WeekSampleFirst, WeekSampleLast - 1, WeekSampleLast);
+				Journal.Pushed[1]++;
+				Generation.Tier[1]++;
+				*WeekSampleFirst = T();
+				for (auto iter = DaySampleFirst; (iter->IsValid() && ((iter - DaySampleFirst) < 6)); iter++) // Half an hour of day samples
+					*WeekSampleFirst += *iter;
+			}
+		}
+		if (ZeroAccumulator)
+		{
+			FakeMRTGFile[1] = T();
+		}
+	}
+}
+// Splits the contents of a log file into lines without copying them, then replays them in time order into the memory mapped structure simulating MRTG log files.
+// GenerateLogFile appends in time order so the lines are almost always already sorted. Only if a file has out of order runs (after a download or a merge) are those runs merged.
+void ReplayLoggedData(const bdaddr_t& TheBlueToothAddress, const ThermometerType TheThermometerType, const std::string_view TheContents)
+{
+	std::vector<std::string_view> TheLines;
+	std::vector<size_t> RunStarts(1, 0); // index of the first line of each ascending run
+	for (size_t LineStart = 0; LineStart < TheContents.size();)
+	{
+		size_t LineEnd = TheContents.find('\n', LineStart);
+		if (LineEnd == std::string_view::npos)
+			LineEnd = TheContents.size();
+		std::string_view TheLine(TheContents.substr(LineStart, LineEnd - LineStart));
+		if (!TheLines.empty() && (TheLine < TheLines.back()))
+			RunStarts.push_back(TheLines.size());
+		TheLines.push_back(TheLine);
+		LineStart = LineEnd + 1;
+	}
+	if (RunStarts.size() > 1)
+	{
+		if (ConsoleVerbosity > 1)
+			std::cout << "[" << getTimeISO8601(true) << "] Merging " << RunStarts.size() << " sorted runs of " << TheLines.size() << " lines" << std::endl;
+		// Merge neighboring runs pairwise until only one run remains. This is linear for the usual case of a few appended runs.
+		RunStarts.push_back(TheLines.size());
+		while (RunStarts.size() > 2)
+		{
+			std::vector<size_t> MergedStarts;
+			size_t index = 0;
+			for (; index + 2 < RunStarts.size(); index += 2)
+			{
+				std::inplace_merge(TheLines.begin() + RunStarts[index], TheLines.begin() + RunStarts[index + 1], TheLines.begin() + RunStarts[index + 2]);
+				MergedStarts.push_back(RunStarts[index]);
+			}
+			for (; index < RunStarts.size(); index++)
+				MergedStarts.push_back(RunStarts[index]);
+			RunStarts.swap(MergedStarts);
+		}
+	}
+	if (TheThermometerType == ThermometerType::RUUVI)
+		for (auto const& SortedLine : TheLines)
+		{
+			Ruuvi_Tag TheValue{ std::string(SortedLine) };
+			if (TheValue.IsValid())
+				UpdateMRTGData(TheBlueToothAddress, TheValue, RuuviMRTGLogs);
+		}
+	else
+		for (auto const& SortedLine : TheLines)
+		{
+			Govee_Temp TheValue{ std::string(SortedLine) };
+			if (TheValue.GetModel() == ThermometerType::Unknown)
+				TheValue.SetModel(TheThermometerType);
+			if (TheValue.IsValid())
+				UpdateMRTGData(TheBlueToothAddress, TheValue, GoveeMRTGLogs);
+		}
+}
+// Remembers how far into each log file we have already replayed, so monitoring only has to read what has been appended since.
+// The device and inode detect the file being replaced (gvh-organizelogs renames the original) and the size detects truncation.
+struct LogFileTail {
+	dev_t Device;
+	ino_t Inode;
+	off_t Offset;
+};
+std::map<std::filesystem::path, LogFileTail> LogFileTails;
+// Returns true if filename.gz ends with a gzip member holding exactly the contents of filename, which is left behind when the program stops between folding a log file into filename.gz and removing it.
+// The trailer of every gzip member holds the CRC-32 and length of its uncompressed data, so only the last eight bytes of filename.gz need to be read.
+bool LogFileInGzip(const std::filesystem::path& filename)
+{
+	bool rval = false;
+	std::ifstream TheFile(filename, std::ios_base::in | std::ios_base::binary);
+	std::ifstream CompressedFile(filename.string() + ".gz", std::ios_base::in | std::ios_base::binary | std::ios_base::ate);
+	if (TheFile.is_open() && CompressedFile.is_open() && (CompressedFile.tellg() >= std::streamoff(18)))	// the smallest gzip member is 18 bytes
+	{
+		const std::string TheContents((std::istreambuf_iterator<char>(TheFile)), std::istreambuf_iterator<char>());
+		unsigned char Trailer[8];
+		CompressedFile.seekg(-std::streamoff(sizeof(Trailer)), std::ios_base::end);
+		if (CompressedFile.read(reinterpret_cast<char*>(Trailer), sizeof(Trailer)))
+		{
+			const uint32_t TrailerCRC(uint32_t(Trailer[0]) | (uint32_t(Trailer[1]) << 8) | (uint32_t(Trailer[2]) << 16) | (uint32_t(Trailer[3]) << 24));
+			const uint32_t TrailerSize(uint32_t(Trailer[4]) | (uint32_t(Trailer[5]) << 8) | (uint32_t(Trailer[6]) << 16) | (uint32_t(Trailer[7]) << 24));
+			const uint32_t TheCRC(crc32(crc32(0, Z_NULL, 0), reinterpret_cast<const Bytef*>(TheContents.data()), TheContents.size()));
+			rval = (TrailerCRC == TheCRC) && (TrailerSize == uint32_t(TheContents.size()));
+		}
+	}
+	return(rval);
+}
+// Adds a log file to filename.gz as a new gzip member, then removes the original along with its index.
+// The new filename.gz is written beside the old one, synced, and renamed over it before the original is removed. A crash at any point leaves either
+// the original alone or the original already inside filename.gz, which LogFileInGzip recognizes, never a month that is only partly compressed.
+// Data for a closed month can still arrive when it's downloaded from a thermometer's memory. That creates a new .txt next to the .txt.gz, which is folded in the same way the next time closed months are compressed.
+bool CompressLogFile(const std::filesystem::path& filename)
+{
+	bool rval = false;
+	std::filesystem::path CompressedFileName(filename.string() + ".gz");
+	std::filesystem::path TempFileName(CompressedFileName.string() + ".tmp");
+	struct stat64 FileStat({ 0 });
+	struct stat64 CompressedStat({ 0 });
+	stat64(CompressedFileName.c_str(), &CompressedStat);	// leaves modification time zero if there isn't one yet
+	if (LogFileInGzip(filename))
+	{
+		if (ConsoleVerbosity > 0)
+			std::cout << "[" << getTimeISO8601(true) << "] Already compressed: " << filename.string() << std::endl;
+		rval = true;
+	}
+	else if (0 == stat64(filename.c_str(), &FileStat))
+	{
+		std::ifstream TheFile(filename, std::ios_base::in | std::ios_base::binary);
+		std::ifstream CompressedFile(CompressedFileName, std::ios_base::in | std::ios_base::binary);
+		const std::string TheContents((std::istreambuf_iterator<char>(TheFile)), std::istreambuf_iterator<char>());
+		std::string Compressed;
+		if (CompressedFile.is_open())	// gzip members can simply be concatenated
+			Compressed.assign((std::istreambuf_iterator<char>(CompressedFile)), std::istreambuf_iterator<char>());
+		const std::string NewMember(GzipString(TheContents));
+		int TempFile = open(TempFileName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0666);
+		if (TheFile.is_open() && !TheFile.bad() && !NewMember.empty() && (TempFile >= 0))
+		{
+			Compressed.append(NewMember);
+			bool bWritten = WriteAll(TempFile, Compressed.data(), Compressed.size()) && (0 == fdatasync(TempFile));
+			bWritten = (0 == close(TempFile)) && bWritten;
+			struct utimbuf ut;
+			ut.actime = std::max(FileStat.st_mtim.tv_sec, CompressedStat.st_mtim.tv_sec);
+			ut.modtime = ut.actime;
+			if (bWritten && (0 == utime(TempFileName.c_str(), &ut)) && (0 == rename(TempFileName.c_str(), CompressedFileName.c_str())))
+			{
+				int TheDirectory = open(LogDirectory.c_str(), O_RDONLY | O_DIRECTORY);	// the rename has to be on disk before the original is removed
+				if (TheDirectory >= 0)
+				{
+					fsync(TheDirectory);
+					close(TheDirectory);
+				}
+				rval = true;
+				if (ConsoleVerbosity > 0)
+					std::cout << "[" << getTimeISO8601(true) << "] Compressed: " << filename.string() << " (" << FileStat.st_size << " bytes) to " << CompressedFileName.string() << std::endl;
+			}
+			else
+			{
+				std::cerr << "Error: Unable to compress " << filename.string() << " to " << CompressedFileName.string() << " " << strerror(errno) << std::endl;
+				std::error_code ec;
+				std::filesystem::remove(TempFileName, ec);
+			}
+		}
+		else
+		{
+			std::cerr << "Error: Unable to compress " << filename.string() << " to " << CompressedFileName.string() << std::endl;
+			if (TempFile >= 0)
+			{
+				close(TempFile);
+				std::error_code ec;
+				std::filesystem::remove(TempFileName, ec);
+			}
+		}
+	}
+	if (rval)
+	{
+		std::error_code ec;
+		std::filesystem::remove(filename, ec);
+		std::filesystem::remove(GenerateLogIndexFileName(filename), ec);
+		LogFileTails.erase(filename);
+	}
+	return(rval);
+}
+// Compresses the log files of every month before the current one. The directory is only searched once each month, or at startup, because a closed month is never written by this program again.
+// Only one file is compressed per call, so the first run with --compress on a directory full of old months doesn't hold up the Bluetooth loop while it works through all of them.
+void CompressClosedLogFiles(void)
+{
+	static int LastMonthChecked = 0;
+	static std::deque<std::filesystem::path> files;
+	if (CompressLogs && !LogDirectory.empty())
+	{
+		time_t TimeNow;
+		time(&TimeNow);
+		struct tm UTC;
+		if (nullptr != gmtime_r(&TimeNow, &UTC))
+		{
+			const int ThisMonth = (UTC.tm_year + 1900) * 12 + UTC.tm_mon;
+			if (ThisMonth != LastMonthChecked)
+			{
+				LastMonthChecked = ThisMonth;
+				SyncLogFiles(true);	// data for the month that just ended may still be staged in memory
+				std::ostringstream CurrentMonth;
+				CurrentMonth << std::dec << UTC.tm_year + 1900 << "-" << std::setw(2) << std::setfill('0') << UTC.tm_mon + 1;
+				const std::regex LogFileRegex("(gvh|ruuvi)-[[:xdigit:]]{12}-([[:digit:]]{4}-[[:digit:]]{2}).txt");
+				files.clear();
+				for (auto const& dir_entry : std::filesystem::directory_iterator{ LogDirectory })
+					if (dir_entry.is_regular_file())
+					{
+						std::smatch LogFileMonth;
+						std::string TheFileName(dir_entry.path().filename().string());
+						if (std::regex_match(TheFileName, LogFileMonth, LogFileRegex))
+							if (LogFileMonth[2].str() < CurrentMonth.str())
+								files.push_back(dir_entry);
+					}
+				sort(files.begin(), files.end());
+			}
+			if (!files.empty())
+			{
+				CompressLogFile(files.front());
+				files.pop_front();
+			}
+		}
+	}
+}
+// Sorts log files by name, except that the compressed part of a month comes ahead of any uncompressed remainder of the same month.
+bool LogFileNameLess(const std::filesystem::path& a, const std::filesystem::path& b)
+{
+	const std::filesystem::path A(a.extension() == ".gz" ? a.parent_path() / a.stem() : a);
+	const std::filesystem::path B(b.extension() == ".gz" ? b.parent_path() / b.stem() : b);
+	if (A == B)
+		return((a.extension() == ".gz") && (b.extension() != ".gz"));
+	return(A < B);
+}
+// If StartTime is set and the file hasn't changed identity since we last read it, only the newly appended lines are replayed.
+// Otherwise, if StartTime is set and the log file has a usable index, only the lines from the hour containing StartTime onward are replayed.
+void ReadLoggedData(const std::filesystem::path& filename, const time_t StartTime = 0)
+{
+	const std::regex ModifiedBluetoothAddressRegex("[[:xdigit:]]{12}");
+	std::smatch BluetoothAddressInFilename;
+	std::string Stem(filename.stem().string());
+	if (std::regex_search(Stem, BluetoothAddressInFilename, ModifiedBluetoothAddressRegex))
+	{
+		bdaddr_t TheBlueToothAddress(string2ba(BluetoothAddressInFilename.str()));
+
+		// Only read the file if it's newer than what we may have cached
+		bool bReadFile = true;
+		struct stat64 FileStat({ 0 });
+		if (0 == stat64(filename.c_str(), &FileStat))	// returns 0 if the file-status information is obtained
 		{
-			TheValues.resize(603); // get rid of anything beyond the five minute data
-			TheValues.erase(TheValues.begin()); // get rid of the first element
+			auto it1 = GoveeMRTGLogs.find(TheBlueToothAddress);
+			if (it1 != GoveeMRTGLogs.end())
+				if (!it1->second.empty())
+					if (FileStat.st_mtim.tv_sec < (it1->second.begin()->Time))	// only read the file if it more recent than existing data
+						bReadFile = false;
+			auto it2 = RuuviMRTGLogs.find(TheBlueToothAddress);
+			if (it2 != RuuviMRTGLogs.end())
+				if (!it2->second.empty())
+					if (FileStat.st_mtim.tv_sec < (it2->second.begin()->Time))	// only read the file if it more recent than existing data
+						bReadFile = false;
 		}
-		else if (graph == GraphType::weekly)
+
+		if (bReadFile)
 		{
-			TheValues.erase(TheValues.begin()); // get rid of the first element
-			std::vector<Govee_Temp> TempValues;
-			for (auto iter = TheValues.begin(); iter != TheValues.end(); iter++)
+			if (ConsoleVerbosity > 0)
+				std::cout << "[" << getTimeISO8601(true) << "] Reading: " << filename.string() << std::endl;
+			else
+				std::cerr << "Reading: " << filename.string() << std::endl;
+			const std::regex GoveeFileRegex("gvh-[[:xdigit:]]{12}-[[:digit:]]{4}-[[:digit:]]{2}.txt(.gz)?");
+			const std::regex RuuviFileRegex("ruuvi-[[:xdigit:]]{12}-[[:digit:]]{4}-[[:digit:]]{2}.txt(.gz)?");
+			const bool bRuuviFile = std::regex_match(filename.filename().string(), RuuviFileRegex);
+			ThermometerType CacheThermometerType = bRuuviFile ? ThermometerType::RUUVI : ThermometerType::Unknown;
+			auto foo = GoveeThermometers.find(TheBlueToothAddress);
+			if ((!bRuuviFile) && (foo != GoveeThermometers.end()))
+				CacheThermometerType = foo->second;
+			const bool bLogFile = bRuuviFile || std::regex_match(filename.filename().string(), GoveeFileRegex);
+			// A compressed month is never appended to, so it is decompressed into memory and replayed in full.
+			if (bLogFile && (filename.extension() == ".gz"))
 			{
-				struct tm UTC;
-				if (0 != gmtime_r(&iter->Time, &UTC))
+				std::string TheContents;
+				if (ReadCompressedLogFile(filename, TheContents))
+					ReplayLoggedData(TheBlueToothAddress, CacheThermometerType, TheContents);
+			}
+			// Map the file into memory and walk the lines in place instead of copying every line into a vector of strings.
+			int TheFile = -1;
+			if (bLogFile && (filename.extension() != ".gz"))
+				TheFile = open(filename.c_str(), O_RDONLY);
+			if (TheFile >= 0)
+			{
+				struct stat64 MapStat({ 0 });
+				if (0 == fstat64(TheFile, &MapStat))
 				{
-					if ((UTC.tm_min == 0) || (UTC.tm_min == 30))
-						TempValues.push_back(*iter);
+					off_t ReadOffset = 0;
+					auto PreviousTail = LogFileTails.find(filename);
+					if (StartTime > 0)
+					{
+						if ((PreviousTail != LogFileTails.end()) &&
+							(PreviousTail->second.Device == MapStat.st_dev) &&
+							(PreviousTail->second.Inode == MapStat.st_ino) &&
+							(PreviousTail->second.Offset <= MapStat.st_size))
+							ReadOffset = PreviousTail->second.Offset;
+						else
+						{
+							if ((PreviousTail != LogFileTails.end()) && (ConsoleVerbosity > 0))
+								std::cout << "[" << getTimeISO8601(true) << "] File replaced or truncated, reloading: " << filename.string() << std::endl;
+							off_t IndexOffset = FindLogIndexOffset(filename, StartTime);
+							if ((IndexOffset > 0) && (IndexOffset < MapStat.st_size))
+								ReadOffset = IndexOffset;
+						}
+					}
+					if (ReadOffset < MapStat.st_size)
+					{
+						// mmap offsets must be page aligned, so map from the start of the page holding ReadOffset
+						const off_t MapOffset = ReadOffset - (ReadOffset % sysconf(_SC_PAGESIZE));
+						const size_t MapLength = MapStat.st_size - MapOffset;
+						void* TheMap = mmap(NULL, MapLength, PROT_READ, MAP_PRIVATE, TheFile, MapOffset);
+						if (TheMap != MAP_FAILED)
+						{
+							madvise(TheMap, MapLength, MADV_SEQUENTIAL);
+							std::string_view TheContents(static_cast<const char*>(TheMap), MapLength);
+							TheContents.remove_prefix(ReadOffset - MapOffset);
+							// Only lines terminated by a newline are replayed and considered consumed, whether the whole file or just its tail is being read.
+							// A partial line at the end is picked up again, once, on the next read.
+							auto LastNewline = TheContents.rfind('\n');
+							const off_t ConsumedOffset = ReadOffset + ((LastNewline == std::string_view::npos) ? 0 : off_t(LastNewline + 1));
+							TheContents = TheContents.substr(0, ConsumedOffset - ReadOffset);
+							if (ConsoleVerbosity > 1)
+								std::cout << "[" << getTimeISO8601(true) << "] Replaying " << TheContents.size() << " bytes from offset " << ReadOffset << " of " << filename.string() << std::endl;
+							ReplayLoggedData(TheBlueToothAddress, CacheThermometerType, TheContents);
+							munmap(TheMap, MapLength);
+							LogFileTails[filename] = { MapStat.st_dev, MapStat.st_ino, ConsumedOffset };
+						}
+						else
+							std::cerr << "Error: mmap " << filename.string() << " " << strerror(errno) << std::endl;
+					}
 				}
+				close(TheFile);
 			}
-			TheValues.resize(TempValues.size());
-			std::copy(TempValues.begin(), TempValues.end(), TheValues.begin());
 		}
-		else if (graph == GraphType::monthly)
+	}
+}
+// Finds log files specific to this program then reads the contents into the memory mapped structure simulating MRTG log files.
+void ReadLoggedData(void)
+{
+	const std::regex LogFileRegex("(gvh|ruuvi)-[[:xdigit:]]{12}-[[:digit:]]{4}-[[:digit:]]{2}.txt(.gz)?");
+	if (!LogDirectory.empty())
+	{
+		if (ConsoleVerbosity > 1)
+			std::cout << "[" << getTimeISO8601(true) << "] ReadLoggedData: " << LogDirectory << std::endl;
+		std::deque<std::filesystem::path> files;
+		for (auto const& dir_entry : std::filesystem::directory_iterator{ LogDirectory })
+			if (dir_entry.is_regular_file())
+				if (std::regex_match(dir_entry.path().filename().string(), LogFileRegex))
+					files.push_back(dir_entry);
+		if (!files.empty())
 		{
-			TheValues.erase(TheValues.begin()); // get rid of the first element
-			std::vector<Govee_Temp> TempValues;
-			for (auto iter = TheValues.begin(); iter != TheValues.end(); iter++)
+			sort(files.begin(), files.end(), LogFileNameLess);
+			while (!files.empty())
 			{
-				struct tm UTC;
-				if (0 != gmtime_r(&iter->Time, &UTC))
+				if ((files.begin()->extension() == ".gz") || !LogFileInGzip(*files.begin()))	// a log file already folded into its .gz would be read twice
+					ReadLoggedData(*files.begin());
+				files.pop_front();
+			}
+		}
+	}
+}
+void MonitorLoggedData(const int SecondsRecent = 35*60)
+{
+	if (!LogDirectory.empty())
+	{
+		for (auto it = GoveeMRTGLogs.begin(); it != GoveeMRTGLogs.end(); it++)
+		{
+			std::filesystem::path filename(GenerateLogFileName(it->first));
+			struct stat64 FileStat({ 0 });
+			if (0 == stat64(filename.c_str(), &FileStat))	// returns 0 if the file-status information is obtained
+				if (!it->second.empty())
+					if (FileStat.st_mtim.tv_sec > (it->second.begin()->Time + (SecondsRecent)))	// only read the file if it's at least thirty five minutes more recent than existing data
+						ReadLoggedData(filename, it->second.begin()->Time);	// lines older than our newest data don't change anything, so start reading at the hour of our newest data
+		}
+	}
+}
+/////////////////////////////////////////////////////////////////////////////
+// The running logger can answer --mrtg queries from memory on a Unix domain socket, saving MRTG a process launch and a log file read for every sensor on every poll.
+// A query is one line with the Bluetooth address and the number of minutes to average. The answer is the same four lines --mrtg prints, or nothing if there's no data.
+// Client sockets never block, so a client that connects and sends nothing, or doesn't read its answer, only holds its own connection until it times out.
+int QuerySocket(-1);
+struct QueryConnection
+{
+	std::string Query;	// bytes received that aren't a complete query yet
+	std::string Answer;	// bytes of the answer the client hasn't taken yet
+	time_t LastActive;
+};
+std::map<int, QueryConnection> QueryConnections;
+const size_t QUERY_MAX_CONNECTIONS(16);
+const time_t QUERY_IDLE_TIMEOUT(2);		// seconds a client may sit without sending its query or taking its answer
+const size_t QUERY_MAX_LENGTH(256);	// longest query accepted
+bool OpenQuerySocket(void)
+{
+	bool rval = false;
+	if (!QuerySocketPath.empty())
+	{
+		struct sockaddr_un QueryAddress({ 0 });
+		QueryAddress.sun_family = AF_UNIX;
+		if (QuerySocketPath.native().size() < sizeof(QueryAddress.sun_path))
+		{
+			QuerySocketPath.native().copy(QueryAddress.sun_path, sizeof(QueryAddress.sun_path) - 1);
+			struct stat64 SocketStat({ 0 });
+			if ((0 == stat64(QuerySocketPath.c_str(), &SocketStat)) && S_ISSOCK(SocketStat.st_mode))
+				unlink(QuerySocketPath.c_str());	// left behind by a previous run that didn't exit cleanly
+			QuerySocket = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+			if ((QuerySocket >= 0) &&
+				(0 == bind(QuerySocket, reinterpret_cast<struct sockaddr*>(&QueryAddress), sizeof(QueryAddress))) &&
+				(0 == listen(QuerySocket, 16)))
+			{
+				chmod(QuerySocketPath.c_str(), QuerySocketMode);	// MRTG usually runs as a different user, so it's given access through the group or --query-mode
+				if (ConsoleVerbosity > 0)
+					std::cout << "[" << getTimeISO8601(true) << "] Listening: " << QuerySocketPath.native() << std::endl;
+				rval = true;
+			}
+			else
+			{
+				std::cerr << "Error: Unable to listen on " << QuerySocketPath.native() << " " << strerror(errno) << std::endl;
+				if (QuerySocket >= 0)
+					close(QuerySocket);
+				QuerySocket = -1;
+			}
+		}
+		else
+			std::cerr << "Error: Socket path too long: " << QuerySocketPath.native() << std::endl;
+	}
+	return(rval);
+}
+void CloseQuerySocket(void)
+{
+	for (auto const& [QueryClient, Connection] : QueryConnections)
+		close(QueryClient);
+	QueryConnections.clear();
+	if (QuerySocket >= 0)
+	{
+		close(QuerySocket);
+		QuerySocket = -1;
+		unlink(QuerySocketPath.c_str());
+	}
+}
+// Averages the day tier samples and the partial sample accumulating in memory over the last Minutes, to the five minute resolution of the day tier.
+// Minutes == 0 is the most recent reading, the same special case as GetLogEntry. Longer than the day tier covers is left to GetLogEntry.
+template <typename T> bool GetMemoryEntry(const bdaddr_t& InAddress, const int Minutes, const std::map<bdaddr_t, std::vector<T>>& MRTGLogs, const std::map<bdaddr_t, T>& LastReadings, T& OutValue)
+{
+	bool rval = false;
+	auto it = MRTGLogs.find(InAddress);
+	if ((it != MRTGLogs.end()) && !it->second.empty() && (size_t(Minutes) * 60 <= DAY_COUNT * DAY_SAMPLE))
+	{
+		const std::vector<T>& FakeMRTGFile(it->second);
+		time_t now;
+		time(&now);
+		const time_t WindowStart(now - (Minutes * 60));
+		T TheValue;
+		if (Minutes == 0)
+		{
+			auto Last = LastReadings.find(InAddress);
+			TheValue = (Last != LastReadings.end()) ? Last->second : FakeMRTGFile[0];
+		}
+		else
+		{
+			if (FakeMRTGFile[1].Time >= WindowStart)
+				TheValue += FakeMRTGFile[1];
+			for (auto index = std::size_t(2); (index < (2 + DAY_COUNT)) && (FakeMRTGFile[index].Time >= WindowStart); index++)
+				TheValue += FakeMRTGFile[index];
+		}
+		if (TheValue.IsValid())
+		{
+			OutValue = TheValue;
+			rval = true;
+		}
+	}
+	return(rval);
+}
+// Answers one query line. Thermometers without data in memory are answered from the log files. --mrtg only reads thermometer logs,
+// so a RuuviTag is only answered from memory, and gets no answer for longer than the day tier covers.
+std::string QueryAnswer(const std::string& TheQuery)
+{
+	std::istringstream ssQuery(TheQuery);
+	std::string TheBlueToothAddressString;
+	int Minutes(0);
+	std::string rval;
+	if ((ssQuery >> TheBlueToothAddressString >> Minutes) && std::regex_match(TheBlueToothAddressString, BluetoothAddressRegex))
+	{
+		const bdaddr_t TheAddress(string2ba(TheBlueToothAddressString));
+		Govee_Temp TheValue;
+		Ruuvi_Tag TheRuuviValue;
+		if (GetMemoryEntry(TheAddress, Minutes, GoveeMRTGLogs, GoveeLastReading, TheValue))
+			rval = MRTGOutput(TheBlueToothAddressString, TheValue);
+		else if (GetMemoryEntry(TheAddress, Minutes, RuuviMRTGLogs, RuuviLastReading, TheRuuviValue))
+			rval = MRTGOutput(TheBlueToothAddressString, TheRuuviValue);
+		else if (GetLogEntry(TheAddress, Minutes, TheValue))
+			rval = MRTGOutput(TheBlueToothAddressString, TheValue);
+		LoggerStats.Queries++;
+		if (ConsoleVerbosity > 1)
+			std::cout << "[" << getTimeISO8601(true) << "] Query: " << TheBlueToothAddressString << " " << Minutes << (rval.empty() ? " (no data)" : "") << std::endl;
+	}
+	return(rval);
+}
+// Sends as much of the answer as the client's socket will take right now. Returns false once the connection should be closed, which is as soon as the whole answer has been sent.
+bool SendQueryConnection(const int QueryClient, QueryConnection& Connection)
+{
+	if (!Connection.Answer.empty())
+	{
+		ssize_t bufDataLen = send(QueryClient, Connection.Answer.data(), Connection.Answer.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+		if (bufDataLen > 0)
+		{
+			time(&Connection.LastActive);
+			Connection.Answer.erase(0, bufDataLen);
+		}
+		else if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
+			Connection.Answer.clear();
+	}
+	return(!Connection.Answer.empty());
+}
+// Reads whatever a client has sent, and answers once its query is complete. Returns false once the connection should be closed.
+bool ServiceQueryConnection(const int QueryClient, QueryConnection& Connection)
+{
+	bool rval = true;
+	char buf[128];
+	ssize_t bufDataLen = recv(QueryClient, buf, sizeof(buf), MSG_DONTWAIT);
+	bool bComplete = (bufDataLen == 0);	// a client may shut down its side once it has sent the query
+	if (bufDataLen > 0)
+	{
+		time(&Connection.LastActive);
+		Connection.Query.append(buf, bufDataLen);
+		bComplete = (Connection.Query.find('\n') != std::string::npos) || (Connection.Query.size() >= QUERY_MAX_LENGTH);
+	}
+	else if ((bufDataLen < 0) && (errno != EAGAIN) && (errno != EWOULDBLOCK))
+		rval = false;
+	if (bComplete)
+	{
+		Connection.Answer = QueryAnswer(Connection.Query);
+		rval = SendQueryConnection(QueryClient, Connection);
+	}
+	return(rval);
+}
+// Accepts every client waiting on the socket. Their queries are read and answered as they arrive by ServiceServerSockets.
+void ServiceQuerySocket(void)
+{
+	if (QuerySocket >= 0)
+	{
+		int QueryClient;
+		while ((QueryClient = accept4(QuerySocket, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0)
+		{
+			if (QueryConnections.size() < QUERY_MAX_CONNECTIONS)
+			{
+				QueryConnection Connection;
+				time(&Connection.LastActive);
+				QueryConnections.insert(std::pair<int, QueryConnection>(QueryClient, Connection));
+			}
+			else
+				close(QueryClient);
+		}
+	}
+}
+// Used by --mrtg when --query-socket is also given. Returns false if the logger isn't listening, so the log files can be read directly instead.
+bool QueryRunningLogger(const std::string& TheBlueToothAddressString, const int Minutes)
+{
+	bool rval = false;
+	struct sockaddr_un QueryAddress({ 0 });
+	QueryAddress.sun_family = AF_UNIX;
+	QuerySocketPath.native().copy(QueryAddress.sun_path, sizeof(QueryAddress.sun_path) - 1);
+	int QueryServer = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if ((QueryServer >= 0) && (0 == connect(QueryServer, reinterpret_cast<struct sockaddr*>(&QueryAddress), sizeof(QueryAddress))))
+	{
+		struct timeval QueryTimeout = { 10, 0 };
+		setsockopt(QueryServer, SOL_SOCKET, SO_RCVTIMEO, &QueryTimeout, sizeof(QueryTimeout));
+		std::ostringstream ssQuery;
+		ssQuery << TheBlueToothAddressString << " " << Minutes << "\n";
+		if (ssQuery.str().size() == size_t(send(QueryServer, ssQuery.str().data(), ssQuery.str().size(), MSG_NOSIGNAL)))
+		{
+			std::string TheAnswer;
+			char buf[256];
+			ssize_t bufDataLen;
+			while ((bufDataLen = recv(QueryServer, buf, sizeof(buf), 0)) > 0)
+				TheAnswer.append(buf, bufDataLen);
+			if (bufDataLen == 0)
+			{
+				std::cout << TheAnswer << std::flush;
+				rval = true;
+			}
+		}
+	}
+	if (QueryServer >= 0)
+		close(QueryServer);
+	return(rval);
+}
+bool ReadTitleMap(const std::filesystem::path& TitleMapFilename)
+{
+	bool rval = false;
+	static time_t LastModified = 0;
+	struct stat64 TitleMapFileStat({ 0 });
+	if (0 == stat64(TitleMapFilename.c_str(), &TitleMapFileStat))
+	{
+		rval = true;
+		if (TitleMapFileStat.st_mtim.tv_sec > LastModified)	// only read the file if it's modified
+		{
+			std::ifstream TheFile(TitleMapFilename);
+			if (TheFile.is_open())
+			{
+				LastModified = TitleMapFileStat.st_mtim.tv_sec;	// only update our time if the file is actually read
+				if (ConsoleVerbosity > 0)
+					std::cout << "[" << getTimeISO8601(true) << "] Reading: " << TitleMapFilename.string() << std::endl;
+				else
+					std::cerr << "Reading: " << TitleMapFilename.string() << std::endl;
+				std::string TheLine;
+
+				while (std::getline(TheFile, TheLine))
 				{
-					if ((UTC.tm_hour % 2 == 0) && (UTC.tm_min == 0))
-						TempValues.push_back(*iter);
+					std::smatch BluetoothAddress;
+					if (std::regex_search(TheLine, BluetoothAddress, BluetoothAddressRegex))
+					{
+						bdaddr_t TheBlueToothAddress(string2ba(BluetoothAddress.str()));
+						const std::string delimiters(" \t");
+						auto i = TheLine.find_first_of(delimiters);		// Find first delimiter
+						i = TheLine.find_first_not_of(delimiters, i);	// Move past consecutive delimiters
+						std::string theTitle = (i == std::string::npos) ? "" : TheLine.substr(i);
+						GoveeBluetoothTitles.insert(std::make_pair(TheBlueToothAddress, theTitle));
+					}
 				}
+				TheFile.close();
 			}
-			TheValues.resize(TempValues.size());
-			std::copy(TempValues.begin(), TempValues.end(), TheValues.begin());
 		}
-		else if (graph == GraphType::yearly)
+	}
+	return(rval);
+}
+// The model recorded with the data, or the one remembered from advertisements for data that didn't record it.
+template <typename T> ThermometerType GetMRTGModel(const bdaddr_t& TheAddress, const std::vector<T>& MRTG)
+{
+	ThermometerType rval = MRTG.front().GetModel();
+	if (rval == ThermometerType::Unknown)
+	{
+		auto foo = GoveeThermometers.find(TheAddress);
+		if (foo != GoveeThermometers.end())
+			rval = foo->second;
+	}
+	return(rval);
+}
+// The title from the title map, or the address without colons and the model. The title map should already have been read.
+std::string GetSVGTitle(const bdaddr_t& TheAddress, const ThermometerType Model)
+{
+	std::string rval;
+	auto foo = GoveeBluetoothTitles.find(TheAddress);
+	if (foo != GoveeBluetoothTitles.end())
+		rval = foo->second;
+	else
+	{
+		rval = ba2string(TheAddress);
+		for (auto pos = rval.find(':'); pos != std::string::npos; pos = rval.find(':'))
+			rval.erase(pos, 1);
+		rval += " " + ThermometerType2String(Model); // default title
+	}
+	return(rval);
+}
+// The file names of a device's graphs and data start with this, gvh-A4C138123456 or ruuvi-DD4CE87A116E.
+std::string GetFileStem(const bdaddr_t& TheAddress, const ThermometerType Model)
+{
+	std::string rval(ba2string(TheAddress));
+	for (auto pos = rval.find(':'); pos != std::string::npos; pos = rval.find(':'))
+		rval.erase(pos, 1);
+	rval.insert(0, Model == ThermometerType::RUUVI ? "ruuvi-" : "gvh-");
+	return(rval);
+}
+/////////////////////////////////////////////////////////////////////////////
+// With --json each device's day, week, month and year data is also written as one small JSON file, and the viewer page draws the graphs in the browser from it.
+// Each tier is a set of columns, newest sample first, the same samples the SVG graphs are drawn from. Temperatures are in Celsius and "fahrenheit" says how the graphs are shown.
+// The time column is the time of the newest sample followed by the seconds from each sample back to the next, which is nearly always the tier's step and compresses to almost nothing.
+std::string JSONString(const std::string& Text)
+{
+	std::string rval("\"");
+	for (auto const& c : Text)
+	{
+		if ((c == '"') || (c == '\\'))
+		{
+			rval += '\\';
+			rval += c;
+		}
+		else if (static_cast<unsigned char>(c) < 0x20)
+		{
+			char Escaped[8];
+			snprintf(Escaped, sizeof(Escaped), "\\u%04x", c);
+			rval += Escaped;
+		}
+		else
+			rval += c;
+	}
+	rval += '"';
+	return(rval);
+}
+template <typename T> std::string GetMRTGJSON(const bdaddr_t& TheAddress, const ThermometerType Model, const std::vector<T>& MRTG, const std::string& Title)
+{
+	const char* TierName[4] = { "day", "week", "month", "year" };
+	const size_t TierSample[4] = { DAY_SAMPLE, WEEK_SAMPLE, MONTH_SAMPLE, YEAR_SAMPLE };
+	const bool bPressure(Model == ThermometerType::RUUVI);	// Govee thermometers don't measure it
+	FormatBuffer JSONFile(64 * 1024);
+	JSONFile << "{\"address\":\"" << ba2string(TheAddress) << "\"";
+	JSONFile << ",\"model\":" << JSONString(ThermometerType2String(Model));
+	JSONFile << ",\"title\":" << JSONString(Title);
+	JSONFile << ",\"fahrenheit\":" << (SVGFahrenheit ? "true" : "false");
+	JSONFile << ",\"time\":" << MRTG[0].Time;
+	const char* ColumnName[11] = { "time", "temperature", "temperature_min", "temperature_max", "humidity", "humidity_min", "humidity_max", "battery", "pressure", "pressure_min", "pressure_max" };
+	for (auto Tier = 0; Tier < 4; Tier++)
+	{
+		const MRTGTier<T> TheValues(MRTG, static_cast<GraphType>(Tier));
+		// Filled side by side in one pass over the samples
+		FormatBuffer Column[11];
+		for (auto index = std::size_t(0); index < TheValues.size(); index++)
+		{
+			const char* Separator(index > 0 ? "," : "");
+			Column[0] << Separator << (index > 0 ? TheValues.Time(index - 1) - TheValues.Time(index) : TheValues.Time(index));
+			Column[1] << Separator << TheValues[index].GetTemperature();
+			Column[2] << Separator << TheValues[index].GetTemperatureMin();
+			Column[3] << Separator << TheValues[index].GetTemperatureMax();
+			Column[4] << Separator << TheValues[index].GetHumidity();
+			Column[5] << Separator << TheValues[index].GetHumidityMin();
+			Column[6] << Separator << TheValues[index].GetHumidityMax();
+			Column[7] << Separator << TheValues[index].GetBattery();
+			if (bPressure)
+			{
+				Column[8] << Separator << TheValues[index].GetPressure();
+				Column[9] << Separator << TheValues[index].GetPressureMin();
+				Column[10] << Separator << TheValues[index].GetPressureMax();
+			}
+		}
+		JSONFile << ",\"" << TierName[Tier] << "\":{\"step\":" << TierSample[Tier];
+		for (auto index = 0; index < (bPressure ? 11 : 8); index++)
+			JSONFile << ",\"" << ColumnName[index] << "\":[" << Column[index].str() << "]";
+		JSONFile << "}";
+	}
+	JSONFile << "}\n";
+	return(JSONFile.str());
+}
+template <typename T> void ReplaceJSON(const bdaddr_t& TheAddress, const ThermometerType Model, const std::vector<T>& MRTG, const std::filesystem::path& JSONFileName, const std::string& Title)
+{
+	if (ConsoleVerbosity > 0)
+		std::cout << "[" << getTimeISO8601(true) << "] Writing: " << JSONFileName.string() << std::endl;
+	else
+		std::cerr << "Writing: " << JSONFileName.string() << std::endl;
+	const std::string Contents(GetMRTGJSON(TheAddress, Model, MRTG, Title));
+	if (ReplaceFile(JSONFileName, Contents, MRTG[0].Time) && SVGGzip)
+		ReplaceGzipFile(JSONFileName, Contents, MRTG[0].Time);
+}
+// The viewer page for the devices named, each by its file stem. It only uses files next to it, so it works from the SVG directory on any web server and from the -w server.
+std::string GetViewerHTML(const std::set<std::string>& FileStems)
+{
+	std::ostringstream HTMLFile;
+	HTMLFile << "<!DOCTYPE html>" << std::endl;
+	HTMLFile << "<html>" << std::endl;
+	HTMLFile << "<head>" << std::endl;
+	HTMLFile << "\t<title>" << ProgramVersionString << "</title>" << std::endl;
+	HTMLFile << "\t<meta charset=\"utf-8\">" << std::endl;
+	HTMLFile << "\t<style type=\"text/css\">" << std::endl;
+	HTMLFile << "\t\tbody { color: dimgrey; font-family: sans-serif; font-size: 12px; }" << std::endl;
+	HTMLFile << "\t\tcanvas { float: left; border: 2px solid grey; margin: 2px; }" << std::endl;
+	HTMLFile << "\t\tdiv { clear: both; }" << std::endl;
+	HTMLFile << "\t</style>" << std::endl;
+	HTMLFile << "</head>" << std::endl;
+	HTMLFile << "<body>" << std::endl;
+	for (auto& FileStem : FileStems)
+		HTMLFile << "\t<div id=\"" << FileStem << "\"></div>" << std::endl;
+	HTMLFile << "\t<script>" << std::endl;
+	HTMLFile << "\tfunction draw(canvas, data, tier) {" << std::endl;
+	HTMLFile << "\t\tconst t = data[tier], n = Math.min(t.time.length, 440), c = canvas.getContext(\"2d\");" << std::endl;
+	HTMLFile << "\t\tconst left = 40, top = 14, width = 440, height = 107;" << std::endl;
+	HTMLFile << "\t\tconst temp = t.temperature.slice(0, n).map(v => data.fahrenheit ? v * 9 / 5 + 32 : v), humi = t.humidity.slice(0, n);" << std::endl;
+	HTMLFile << "\t\tconst line = (values, color) => {" << std::endl;
+	HTMLFile << "\t\t\tconst min = Math.min(...values), max = Math.max(...values), scale = max > min ? height / (max - min) : 0;" << std::endl;
+	HTMLFile << "\t\t\tc.strokeStyle = color; c.beginPath();" << std::endl;
+	HTMLFile << "\t\t\tvalues.forEach((v, i) => c.lineTo(left + i, top + (max - v) * scale));" << std::endl;
+	HTMLFile << "\t\t\tc.stroke();" << std::endl;
+	HTMLFile << "\t\t\treturn [min, max];" << std::endl;
+	HTMLFile << "\t\t};" << std::endl;
+	HTMLFile << "\t\tc.font = \"12px sans-serif\"; c.fillStyle = \"dimgrey\";" << std::endl;
+	HTMLFile << "\t\tc.fillText(data.title + \" \" + tier, left, top - 2);" << std::endl;
+	HTMLFile << "\t\tc.strokeStyle = \"dimgrey\"; c.strokeRect(left, top, width, height);" << std::endl;
+	HTMLFile << "\t\tif (n > 0) {" << std::endl;
+	HTMLFile << "\t\t\tconst h = line(humi, \"green\"), r = line(temp, \"blue\");" << std::endl;
+	HTMLFile << "\t\t\tc.fillStyle = \"blue\"; c.textAlign = \"right\";" << std::endl;
+	HTMLFile << "\t\t\tc.fillText(r[1].toFixed(1), left - 2, top + 10); c.fillText(r[0].toFixed(1), left - 2, top + height);" << std::endl;
+	HTMLFile << "\t\t\tc.fillStyle = \"green\"; c.textAlign = \"left\";" << std::endl;
+	HTMLFile << "\t\t\tc.fillText(h[1].toFixed(1), left + width + 2, top + 10); c.fillText(h[0].toFixed(1), left + width + 2, top + height);" << std::endl;
+	HTMLFile << "\t\t\tc.fillStyle = \"dimgrey\"; c.textAlign = \"right\";" << std::endl;
+	HTMLFile << "\t\t\tc.fillText(new Date(t.time[0] * 1000).toLocaleString(), left + width, top - 2);" << std::endl;
+	HTMLFile << "\t\t}" << std::endl;
+	HTMLFile << "\t}" << std::endl;
+	HTMLFile << "\tfunction load(div) {" << std::endl;
+	HTMLFile << "\t\tfetch(div.id + \".json\", { cache: \"no-cache\" }).then(r => r.json()).then(data => {" << std::endl;
+	HTMLFile << "\t\t\tdiv.replaceChildren();" << std::endl;
+	HTMLFile << "\t\t\tfor (const tier of [\"day\", \"week\", \"month\", \"year\"]) {" << std::endl;
+	HTMLFile << "\t\t\t\tconst canvas = document.createElement(\"canvas\");" << std::endl;
+	HTMLFile << "\t\t\t\tcanvas.width = 500; canvas.height = 135;" << std::endl;
+	HTMLFile << "\t\t\t\tdiv.appendChild(canvas);" << std::endl;
+	HTMLFile << "\t\t\t\tdraw(canvas, data, tier);" << std::endl;
+	HTMLFile << "\t\t\t}" << std::endl;
+	HTMLFile << "\t\t}).catch(e => { div.textContent = div.id + \": \" + e; });" << std::endl;
+	HTMLFile << "\t}" << std::endl;
+	HTMLFile << "\tfunction loadAll() { document.querySelectorAll(\"body > div\").forEach(load); }" << std::endl;
+	HTMLFile << "\tloadAll();" << std::endl;
+	HTMLFile << "\tsetInterval(loadAll, 300000);" << std::endl;
+	HTMLFile << "\t</script>" << std::endl;
+	HTMLFile << "</body>" << std::endl;
+	HTMLFile << "</html>" << std::endl;
+	return(HTMLFile.str());
+}
+/////////////////////////////////////////////////////////////////////////////
+// With --svg-threads the graphs are drawn and written by a fixed number of worker threads, so the loop servicing Bluetooth only copies the tiers that changed and queues them.
+// Each job owns its copy of the data and draws every variant of one graph from it, or writes the JSON export of one device.
+// There is at most one job queued for each output, and an output is only written by one worker at a time.
+class SVGJob {
+public:
+	std::filesystem::path OutputPath;	// the graph without a variant name, even when only other variants are written
+	virtual ~SVGJob() { };
+	virtual void Render(void) = 0;
+};
+template <typename T> class SVGJobData : public SVGJob {
+public:
+	std::vector<T> TheValues;
+	std::string Title;
+	GraphType graph = GraphType::daily;
+	std::vector<std::pair<std::filesystem::path, SVGVariant>> Outputs;
+	void Render(void);
+};
+template <typename T> void SVGJobData<T>::Render(void)
+{
+	const MRTGTier<T> Values(TheValues);
+	SVGRanges Ranges;
+	for (auto const& [SVGFileName, Variant] : Outputs)
+		ReplaceSVG(Values, Ranges, SVGFileName, Title, graph, Variant);
+}
+template <typename T> class JSONJobData : public SVGJob {
+public:
+	bdaddr_t TheAddress;
+	ThermometerType Model = ThermometerType::Unknown;
+	std::vector<T> MRTG;	// all four tiers
+	std::string Title;
+	void Render(void);
+};
+template <typename T> void JSONJobData<T>::Render(void)
+{
+	ReplaceJSON(TheAddress, Model, MRTG, OutputPath, Title);
+}
+std::mutex SVGQueueMutex;
+std::condition_variable SVGQueueChanged;
+std::deque<std::unique_ptr<SVGJob>> SVGQueue;
+std::set<std::filesystem::path> SVGRendering;	// graphs a worker is writing now
+bool bSVGWorkersStop = false;
+std::vector<std::thread> SVGWorkers;
+void SVGWorker(void)
+{
+	std::unique_lock<std::mutex> Lock(SVGQueueMutex);
+	while (!(bSVGWorkersStop && SVGQueue.empty()))
+	{
+		auto Job = SVGQueue.begin();
+		while ((Job != SVGQueue.end()) && (SVGRendering.count((*Job)->OutputPath) > 0))
+			Job++;
+		if (Job == SVGQueue.end())
+			SVGQueueChanged.wait(Lock);
+		else
 		{
-			TheValues.erase(TheValues.begin()); // get rid of the first element
-			std::vector<Govee_Temp> TempValues;
-			for (auto iter = TheValues.begin(); iter != TheValues.end(); iter++)
+			std::unique_ptr<SVGJob> TheJob(std::move(*Job));
+			SVGQueue.erase(Job);
+			SVGRendering.insert(TheJob->OutputPath);
+			Lock.unlock();
+			const auto PerfStart(std::chrono::steady_clock::now());
+			TheJob->Render();
 			{
-				struct tm UTC;
-				if (0 != gmtime_r(&iter->Time, &UTC))
-				{
-					if ((UTC.tm_hour == 0) && (UTC.tm_min == 0))
-						TempValues.push_back(*iter);
-				}
+				std::lock_guard<std::mutex> PerfLock(PerfStatsMutex);
+				PerfStats.SVGRender.Add(PerfStart);
 			}
-			TheValues.resize(TempValues.size());
-			std::copy(TempValues.begin(), TempValues.end(), TheValues.begin());
+			Lock.lock();
+			SVGRendering.erase(TheJob->OutputPath);
+			SVGQueueChanged.notify_all();	// another job for the same file may be waiting
 		}
 	}
 }
-// Returns a curated vector of data points specific to the requested graph type from the internal memory structure that fakes the structure of a real MRTG log file on disk. 
-// This is useful for generating SVG files without having to read from disk, but it also allows for more flexibility in how the data is stored in memory and how it can be manipulated before being used to generate SVG files.
-template <typename T> void ReadMRTGData(const std::vector<T>& MRTGLog, std::vector<T>& TheValues, const GraphType graph = GraphType::daily)
+void StartSVGWorkers(void)
 {
-	if (!MRTGLog.empty())
+	if ((SVGThreads > 0) && (!SVGDirectory.empty()))
+	{
+		// Signals are left to the main thread, where the loops expect them to interrupt select and sigwait.
+		sigset_t AllSignals;
+		sigset_t PreviousSignals;
+		sigfillset(&AllSignals);
+		pthread_sigmask(SIG_BLOCK, &AllSignals, &PreviousSignals);
+		bSVGWorkersStop = false;
+		for (auto index = 0; index < SVGThreads; index++)
+			SVGWorkers.push_back(std::thread(SVGWorker));
+		pthread_sigmask(SIG_SETMASK, &PreviousSignals, NULL);
+		if (ConsoleVerbosity > 0)
+			std::cout << "[" << getTimeISO8601(true) << "] Started " << SVGWorkers.size() << " SVG worker threads" << std::endl;
+	}
+}
+// Lets the workers finish everything already queued, so the graphs on disk are current when we exit.
+void StopSVGWorkers(void)
+{
+	if (!SVGWorkers.empty())
 	{
-		auto DaySampleFirst = MRTGLog.begin() + 2;
-		auto DaySampleLast = MRTGLog.begin() + 1 + DAY_COUNT;
-		auto WeekSampleFirst = MRTGLog.begin() + 2 + DAY_COUNT;
-		auto WeekSampleLast = MRTGLog.begin() + 1 + DAY_COUNT + WEEK_COUNT;
-		auto MonthSampleFirst = MRTGLog.begin() + 2 + DAY_COUNT + WEEK_COUNT;
-		auto MonthSampleLast = MRTGLog.begin() + 1 + DAY_COUNT + WEEK_COUNT + MONTH_COUNT;
-		auto YearSampleFirst = MRTGLog.begin() + 2 + DAY_COUNT + WEEK_COUNT + MONTH_COUNT;
-		auto YearSampleLast = MRTGLog.begin() + 1 + DAY_COUNT + WEEK_COUNT + MONTH_COUNT + YEAR_COUNT;
-		if (graph == GraphType::daily)
-		{
-			TheValues.resize(DAY_COUNT);
-			std::copy(DaySampleFirst, DaySampleLast, TheValues.begin());
-			auto iter = TheValues.begin();
-			while (iter->IsValid() && (iter != TheValues.end()))
-				iter++;
-			TheValues.resize(iter - TheValues.begin());
-			TheValues.begin()->Time = MRTGLog.begin()->Time; //HACK: include the most recent time sample
-		}
-		else if (graph == GraphType::weekly)
-		{
-			TheValues.resize(WEEK_COUNT);
-			std::copy(WeekSampleFirst, WeekSampleLast, TheValues.begin());
-			auto iter = TheValues.begin();
-			while (iter->IsValid() && (iter != TheValues.end()))
-				iter++;
-			TheValues.resize(iter - TheValues.begin());
-		}
-		else if (graph == GraphType::monthly)
-		{
-			TheValues.resize(MONTH_COUNT);
-			std::copy(MonthSampleFirst, MonthSampleLast, TheValues.begin());
-			auto iter = TheValues.begin();
-			while (iter->IsValid() && (iter != TheValues.end()))
-				iter++;
-			TheValues.resize(iter - TheValues.begin());
-		}
-		else if (graph == GraphType::yearly)
 		{
-			TheValues.resize(YEAR_COUNT);
-			std::copy(YearSampleFirst, YearSampleLast, TheValues.begin());
-			auto iter = TheValues.begin();
-			while (iter->IsValid() && (iter != TheValues.end()))
-				iter++;
-			TheValues.resize(iter - TheValues.begin());
+			std::lock_guard<std::mutex> Lock(SVGQueueMutex);
+			bSVGWorkersStop = true;
 		}
+		SVGQueueChanged.notify_all();
+		for (auto& Worker : SVGWorkers)
+			Worker.join();
+		SVGWorkers.clear();
 	}
 }
-// Interesting ideas about SVG and possible tools to look at: https://blog.usejournal.com/of-svg-minification-and-gzip-21cd26a5d007
-// Tools Mentioned: svgo gzthermal https://github.com/subzey/svg-gz-supplement/
-// Takes a curated vector of data points for a specific graph type and writes a SVG file to disk.
-template <typename T> void WriteSVG(const std::vector<T>& TheValues, const std::filesystem::path& SVGFileName, const std::string& Title = "", const GraphType graph = GraphType::daily, const bool Fahrenheit = true, const bool DrawBattery = false, const bool MinMax = false)
+// A job still waiting for the same output is replaced, so the queue never holds more than one job per output.
+void QueueJob(std::unique_ptr<SVGJob> TheJob)
 {
-	if (!TheValues.empty())
 	{
-		// By declaring these items here, I'm then basing all my other dimensions on these
-		const std::size_t SVGWidth(500);
-		const std::size_t SVGHeight(135);
-		const std::size_t FontSize(12);
-		const std::size_t TickSize(2);
-		std::size_t GraphWidth = SVGWidth - (FontSize * 5);
-		struct stat64 SVGStat({0});	// Zero the stat64 structure on allocation
-		if (-1 == stat64(SVGFileName.c_str(), &SVGStat))
-			if (ConsoleVerbosity > 3)
-				std::cout << "[" << getTimeISO8601(true) << "] " << std::strerror(errno) << ": " << SVGFileName << std::endl;
-		if (TheValues.begin()->Time > SVGStat.st_mtim.tv_sec)	// only write the file if we have new data
+		std::lock_guard<std::mutex> Lock(SVGQueueMutex);
+		auto Job = SVGQueue.begin();
+		while ((Job != SVGQueue.end()) && ((*Job)->OutputPath != TheJob->OutputPath))
+			Job++;
+		if (Job == SVGQueue.end())
+			SVGQueue.push_back(std::move(TheJob));
+		else
+			*Job = std::move(TheJob);
+	}
+	SVGQueueChanged.notify_one();
+}
+// Takes the contents of TheValues and Outputs.
+template <typename T> void QueueSVG(std::vector<T>& TheValues, std::vector<std::pair<std::filesystem::path, SVGVariant>>& Outputs, const std::filesystem::path& SVGFileName, const std::string& Title, const GraphType graph)
+{
+	std::unique_ptr<SVGJobData<T>> TheJob(new SVGJobData<T>);
+	TheJob->OutputPath = SVGFileName;
+	TheJob->TheValues.swap(TheValues);
+	TheJob->Outputs.swap(Outputs);
+	TheJob->Title = Title;
+	TheJob->graph = graph;
+	QueueJob(std::move(TheJob));
+}
+// Copies all of the tiers, because the workers write after this thread has moved on and updated them.
+template <typename T> void QueueJSON(const bdaddr_t& TheAddress, const ThermometerType Model, const std::vector<T>& MRTG, const std::filesystem::path& JSONFileName, const std::string& Title)
+{
+	std::unique_ptr<JSONJobData<T>> TheJob(new JSONJobData<T>);
+	TheJob->OutputPath = JSONFileName;
+	TheJob->TheAddress = TheAddress;
+	TheJob->Model = Model;
+	TheJob->MRTG = MRTG;
+	TheJob->Title = Title;
+	QueueJob(std::move(TheJob));
+}
+// Writes the day, week, month and year graphs for a single device in each variant. The title map should already have been read.
+// Every variant of a graph is drawn from the same samples, so they're looked at once for the ranges of all of them.
+template <typename T> void WriteDeviceSVG(const bdaddr_t& TheAddress, const std::vector<T>& MRTG)
+{
+	if ((!MRTG.empty()) && (!SVGDirectory.empty()))	// graphs may only be served over HTTP
+	{
+		TRACE_SCOPE("SVG");
+		const auto PerfStart(std::chrono::steady_clock::now());
+		const ThermometerType CacheThermometerType(GetMRTGModel(TheAddress, MRTG));
+		const std::string ssTitle(GetSVGTitle(TheAddress, CacheThermometerType));
+		const std::string FileStem(GetFileStem(TheAddress, CacheThermometerType));
+		const MRTGGeneration& Generation(MRTGGenerations[TheAddress]);
+		auto Written = SVGGenerations.insert(std::make_pair(TheAddress, MRTGGeneration()));	// a new entry means nothing has been written since we started, so every graph is checked against its file
+		const std::string GraphSuffix[4] = { "-day.svg", "-week.svg", "-month.svg", "-year.svg" };
+		if (JSONExport && (Written.second || (Written.first->second.Tier[0] != Generation.Tier[0])))	// every new sample changes the day tier
+		{
+			std::filesystem::path OutputPath(SVGDirectory / (FileStem + ".json"));
+			if (SVGWorkers.empty())
+				ReplaceJSON(TheAddress, CacheThermometerType, MRTG, OutputPath, ssTitle);
+			else
+				QueueJSON(TheAddress, CacheThermometerType, MRTG, OutputPath, ssTitle);
+		}
+		std::vector<T> JobValues;
+		std::vector<std::pair<std::filesystem::path, SVGVariant>> JobOutputs;
+		for (auto Tier = 0; Tier < 4; Tier++)
 		{
-			std::ofstream SVGFile(SVGFileName);
-			if (SVGFile.is_open())
+			if (Written.second || (Written.first->second.Tier[Tier] != Generation.Tier[Tier]))
 			{
-				if (ConsoleVerbosity > 0)
-					std::cout << "[" << getTimeISO8601(true) << "] Writing: " << SVGFileName.string() << " With Title: " << Title << std::endl;
-				else
-					std::cerr << "Writing: " << SVGFileName.string() << " With Title: " << Title << std::endl;
-				std::ostringstream tempOString;
-				tempOString << "Temperature (" << std::fixed << std::setprecision(1) << TheValues[0].GetTemperature(Fahrenheit) << "\u00B0" << (Fahrenheit ? "F)" : "C)");
-				const std::string YLegendTemperature(tempOString.str());
-				tempOString.str("");
-				tempOString << "Humidity (" << std::fixed << std::setprecision(1) << TheValues[0].GetHumidity() << "%)";
-				const std::string YLegendHumidity(tempOString.str());
-				tempOString.str("");
-				tempOString << "Battery (" << TheValues[0].GetBattery() << "%)";
-				const std::string YLegendBattery(tempOString.str());
-				tempOString.str("");
-				tempOString << "Pressure (" << std::fixed << std::setprecision(1) << TheValues[0].GetPressure() << " hPa)";
-				const std::string YLegendPressure(tempOString.str());
-				int GraphTop = FontSize + TickSize;
-				int GraphBottom = SVGHeight - GraphTop;
-				int GraphRight = SVGWidth - GraphTop;
-				double TempMin = DBL_MAX;
-				double TempMax = -DBL_MAX;
-				double HumiMin = DBL_MAX;
-				double HumiMax = -DBL_MAX;
-				double PressureMin = DBL_MAX;
-				double PressureMax = -DBL_MAX;
-				if (MinMax)
-					for (auto index = std::size_t(0); index < (GraphWidth < TheValues.size() ? GraphWidth : TheValues.size()); index++)
-					{
-						TempMin = std::min(TempMin, TheValues[index].GetTemperatureMin(Fahrenheit));
-						TempMax = std::max(TempMax, TheValues[index].GetTemperatureMax(Fahrenheit));
-						HumiMin = std::min(HumiMin, TheValues[index].GetHumidityMin());
-						HumiMax = std::max(HumiMax, TheValues[index].GetHumidityMax());
-						PressureMin = std::min(PressureMin, TheValues[index].GetPressureMin());
-						PressureMax = std::max(PressureMax, TheValues[index].GetPressureMax());
-					}
-				else
-					for (auto index = std::size_t(0); index < (GraphWidth < TheValues.size() ? GraphWidth : TheValues.size()); index++)
-					{
-						TempMin = std::min(TempMin, TheValues[index].GetTemperature(Fahrenheit));
-						TempMax = std::max(TempMax, TheValues[index].GetTemperature(Fahrenheit));
-						HumiMin = std::min(HumiMin, TheValues[index].GetHumidity());
-						HumiMax = std::max(HumiMax, TheValues[index].GetHumidity());
-						PressureMin = std::min(PressureMin, TheValues[index].GetPressure());
-						PressureMax = std::max(PressureMax, TheValues[index].GetPressure());
-					}
-				const bool DrawHumidity = (HumiMax - HumiMin) > 0.1;
-				if (DrawHumidity)
-				{
-					GraphWidth -= FontSize * 2;
-					GraphRight -= FontSize + TickSize * 2;
-				}
-				if (DrawBattery)
-					GraphWidth -= FontSize;
-				const double MinPressureDifferential = 4.0;
-				const bool DrawPressure = PressureMax - PressureMin > MinPressureDifferential;
-				if (DrawPressure)
-				{
-					// Space for legend to be drawn on the right of the graph plus space for one more legend line on the left.
-					GraphWidth -= FontSize;
-					// I took the next line out because I'm drawing pressure ledgend over the graph surface instead of to the right of the graph, so I don't need to make extra space on the right side of the graph for the legend. This also allows me to use more of the graph surface for drawing the pressure line which is helpful because the pressure differential is often small and can be hard to see if I don't use as much of the graph surface as possible.
-					//GraphRight -= FontSize + TickSize * 2;
-				}
-				int GraphLeft = GraphRight - GraphWidth;
-				int GraphVerticalDivision = (GraphBottom - GraphTop) / 4;
-
-				const double TempVerticalDivision = (TempMax - TempMin) / 4;
-				const double TempVerticalFactor = (GraphBottom - GraphTop) / (TempMax - TempMin);
-				const double HumiVerticalDivision = (HumiMax - HumiMin) / 4;
-				const double HumiVerticalFactor = (GraphBottom - GraphTop) / (HumiMax - HumiMin);
-				const double PressureVerticalDivision = (PressureMax - PressureMin) / 4;
-				const double PressureVerticalFactor = (GraphBottom - GraphTop) / (PressureMax - PressureMin);
-				int FreezingLine = 0; // outside the range of the graph
-				if (Fahrenheit)
-				{
-					if ((TempMin < 32) && (32 < TempMax))
-						FreezingLine = int(((TempMax - 32.0) * TempVerticalFactor)) + GraphTop;
-				}
-				else
-				{
-					if ((TempMin < 0) && (0 < TempMax))
-						FreezingLine = int((TempMax * TempVerticalFactor)) + GraphTop;
-				}
-
-				SVGFile << "<?xml version=\"1.0\" encoding=\"utf-8\" standalone=\"no\"?>" << std::endl;
-				SVGFile << "<svg xmlns=\"http://www.w3.org/2000/svg\" xmlns:xlink=\"http://www.w3.org/1999/xlink\" width=\"" << SVGWidth << "\" height=\"" << SVGHeight << "\">" << std::endl;
-				SVGFile << "\t<!-- Created by: " << ProgramVersionString << " -->" << std::endl;
-				SVGFile << "\t<clipPath id=\"GraphRegion\"><polygon points=\"" << GraphLeft << "," << GraphTop << " " << GraphRight << "," << GraphTop << " " << GraphRight << "," << GraphBottom << " " << GraphLeft << "," << GraphBottom << "\" /></clipPath>" << std::endl;
-				SVGFile << "\t<style>" << std::endl;
-				SVGFile << "\t\ttext { font-family: sans-serif; font-size: " << FontSize << "px; fill: dimgrey; }" << std::endl;
-				SVGFile << "\t\tline { stroke: dimgrey; }" << std::endl;
-				SVGFile << "\t\tpolygon { fill-opacity: 0.5; }" << std::endl;
-				if (DrawPressure)
-					SVGFile << "\t\t.barometer-label { font-family: Georgia, serif; font-style: italic; font-size: " << int(PressureVerticalFactor * 10) << "px; opacity: 0.5; clip-path: url(#GraphRegion); text-anchor: middle; dominant-baseline: middle; }" << std::endl;
-#ifdef _DARK_STYLE_
-				SVGFile << "\t@media only screen and (prefers-color-scheme: dark) {" << std::endl;
-				SVGFile << "\t\ttext { fill: grey; }" << std::endl;
-				SVGFile << "\t\tline { stroke: grey; }" << std::endl;
-				SVGFile << "\t}" << std::endl;
-#endif // _DARK_STYLE_
-				SVGFile << "\t</style>" << std::endl;
-#ifdef DEBUG
-				SVGFile << "<!-- HumiMax: " << HumiMax << " -->" << std::endl;
-				SVGFile << "<!-- HumiMin: " << HumiMin << " -->" << std::endl;
-				SVGFile << "<!-- HumiVerticalFactor: " << HumiVerticalFactor << " -->" << std::endl;
-#endif // DEBUG
-				SVGFile << "\t<rect style=\"fill-opacity:0;stroke:grey;stroke-width:2\" width=\"" << SVGWidth << "\" height=\"" << SVGHeight << "\" />" << std::endl;
-
-				// Legend Text
-				int LegendIndex = 1;
-				SVGFile << "\t<text x=\"" << GraphLeft << "\" y=\"" << GraphTop - 2 << "\">" << Title << "</text>" << std::endl;
-				SVGFile << "\t<text style=\"text-anchor:end\" x=\"" << GraphRight << "\" y=\"" << GraphTop - 2 << "\">" << timeToExcelLocal(TheValues[0].Time) << "</text>" << std::endl;
-				SVGFile << "\t<text style=\"fill:blue;text-anchor:middle\" x=\"" << FontSize * LegendIndex << "\" y=\"50%\" transform=\"rotate(270 " << FontSize * LegendIndex << "," << (GraphTop + GraphBottom) / 2 << ")\">" << YLegendTemperature << "</text>" << std::endl;
-				if (DrawHumidity)
-				{
-					LegendIndex++;
-					SVGFile << "\t<text style=\"fill:green;text-anchor:middle\" x=\"" << FontSize * LegendIndex << "\" y=\"50%\" transform=\"rotate(270 " << FontSize * LegendIndex << "," << (GraphTop + GraphBottom) / 2 << ")\">" << YLegendHumidity << "</text>" << std::endl;
-				}
-				if (DrawPressure)
-				{
-					LegendIndex++;
-					SVGFile << "\t<text style=\"fill:purple;text-anchor:middle\" x=\"" << FontSize * LegendIndex << "\" y=\"50%\" transform=\"rotate(270 " << FontSize * LegendIndex << "," << (GraphTop + GraphBottom) / 2 << ")\">" << YLegendPressure << "</text>" << std::endl;
-				}
-				if (DrawBattery)
-				{
-					LegendIndex++;
-					SVGFile << "\t<text style=\"fill:OrangeRed\" text-anchor=\"middle\" x=\"" << FontSize * LegendIndex << "\" y=\"50%\" transform=\"rotate(270 " << FontSize * LegendIndex << "," << (GraphTop + GraphBottom) / 2 << ")\">" << YLegendBattery << "</text>" << std::endl;
-				}
-				if (DrawHumidity)
-				{
-					if (MinMax)
-					{
-						SVGFile << "\t<!-- Humidity Max -->" << std::endl;
-						SVGFile << "\t<polygon style=\"fill:lime;stroke:green;clip-path:url(#GraphRegion)\" points=\"";
-						SVGFile << GraphLeft + 1 << "," << GraphBottom - 1 << " ";
-						for (auto index = std::size_t(0); index < (GraphWidth < TheValues.size() ? GraphWidth : TheValues.size()); index++)
-							SVGFile << index + GraphLeft << "," << int(((HumiMax - TheValues[index].GetHumidityMax()) * HumiVerticalFactor) + GraphTop) << " ";
-						if (GraphWidth < TheValues.size())
-							SVGFile << GraphRight - 1 << "," << GraphBottom - 1;
-						else
-							SVGFile << GraphRight - (GraphWidth - TheValues.size()) << "," << GraphBottom - 1;
-						SVGFile << "\" />" << std::endl;
-						SVGFile << "\t<!-- Humidity Min -->" << std::endl;
-						SVGFile << "\t<polygon style=\"fill:lime;stroke:green;clip-path:url(#GraphRegion)\" points=\"";
-						SVGFile << GraphLeft + 1 << "," << GraphBottom - 1 << " ";
-						for (auto index = std::size_t(0); index < (GraphWidth < TheValues.size() ? GraphWidth : TheValues.size()); index++)
-							SVGFile << index + GraphLeft << "," << int(((HumiMax - TheValues[index].GetHumidityMin()) * HumiVerticalFactor) + GraphTop) << " ";
-						if (GraphWidth < TheValues.size())
-							SVGFile << GraphRight - 1 << "," << GraphBottom - 1;
-						else
-							SVGFile << GraphRight - (GraphWidth - TheValues.size()) << "," << GraphBottom - 1;
-						SVGFile << "\" />" << std::endl;
-					}
-					else
-					{
-						// Humidity Graphic as a Filled polygon
-						SVGFile << "\t<!-- Humidity -->" << std::endl;
-						SVGFile << "\t<polygon style=\"fill:lime;stroke:green;clip-path:url(#GraphRegion)\" points=\"";
-						SVGFile << GraphLeft + 1 << "," << GraphBottom - 1 << " ";
-						for (auto index = std::size_t(0); index < (GraphWidth < TheValues.size() ? GraphWidth : TheValues.size()); index++)
-							SVGFile << index + GraphLeft << "," << int(((HumiMax - TheValues[index].GetHumidity()) * HumiVerticalFactor) + GraphTop) << " ";
-						if (GraphWidth < TheValues.size())
-							SVGFile << GraphRight - 1 << "," << GraphBottom - 1;
-						else
-							SVGFile << GraphRight - (GraphWidth - TheValues.size()) << "," << GraphBottom - 1;
-						SVGFile << "\" />" << std::endl;
-					}
-				}
-
-				// Top Line
-				SVGFile << "\t<line x1=\"" << GraphLeft - TickSize << "\" y1=\"" << GraphTop << "\" x2=\"" << GraphRight + TickSize << "\" y2=\"" << GraphTop << "\"/>" << std::endl;
-				SVGFile << "\t<text style=\"fill:blue;text-anchor:end;dominant-baseline:middle\" x=\"" << GraphLeft - TickSize << "\" y=\"" << GraphTop << "\">" << std::fixed << std::setprecision(1) << TempMax << "</text>" << std::endl;
-				if (DrawHumidity)
-					SVGFile << "\t<text style=\"fill:green;dominant-baseline:middle\" x=\"" << GraphRight + TickSize << "\" y=\"" << GraphTop << "\">" << std::fixed << std::setprecision(1) << HumiMax << "</text>" << std::endl;
-				if (DrawPressure)
-					SVGFile << "\t<text style=\"fill:purple;text-anchor:end;dominant-baseline:middle\" x=\"" << GraphRight + TickSize << "\" y=\"" << GraphTop << "\">" << std::fixed << std::setprecision(1) << PressureMax << "</text>" << std::endl;
-
-				// Bottom Line
-				SVGFile << "\t<line x1=\"" << GraphLeft - TickSize << "\" y1=\"" << GraphBottom << "\" x2=\"" << GraphRight + TickSize << "\" y2=\"" << GraphBottom << "\"/>" << std::endl;
-				SVGFile << "\t<text style=\"fill:blue;text-anchor:end;dominant-baseline:middle\" x=\"" << GraphLeft - TickSize << "\" y=\"" << GraphBottom << "\">" << std::fixed << std::setprecision(1) << TempMin << "</text>" << std::endl;
-				if (DrawHumidity)
-					SVGFile << "\t<text style=\"fill:green;dominant-baseline:middle\" x=\"" << GraphRight + TickSize << "\" y=\"" << GraphBottom << "\">" << std::fixed << std::setprecision(1) << HumiMin << "</text>" << std::endl;
-				if (DrawPressure)
-					SVGFile << "\t<text style=\"fill:purple;text-anchor:end;dominant-baseline:middle\" x=\"" << GraphRight + TickSize << "\" y=\"" << GraphBottom << "\">" << std::fixed << std::setprecision(1) << PressureMin << "</text>" << std::endl;
-
-
-				// Left Line
-				SVGFile << "\t<line x1=\"" << GraphLeft << "\" y1=\"" << GraphTop << "\" x2=\"" << GraphLeft << "\" y2=\"" << GraphBottom << "\"/>" << std::endl;
-
-				// Right Line
-				SVGFile << "\t<line x1=\"" << GraphRight << "\" y1=\"" << GraphTop << "\" x2=\"" << GraphRight << "\" y2=\"" << GraphBottom << "\"/>" << std::endl;
-
-				// Vertical Division Dashed Lines
-				for (auto index = 1; index < 4; index++)
-				{
-					SVGFile << "\t<line style=\"stroke-dasharray:1\" x1=\"" << GraphLeft - TickSize << "\" y1=\"" << GraphTop + (GraphVerticalDivision * index) << "\" x2=\"" << GraphRight + TickSize << "\" y2=\"" << GraphTop + (GraphVerticalDivision * index) << "\" />" << std::endl;
-					SVGFile << "\t<text style=\"fill:blue;text-anchor:end;dominant-baseline:middle\" x=\"" << GraphLeft - TickSize << "\" y=\"" << GraphTop + (GraphVerticalDivision * index) << "\">" << std::fixed << std::setprecision(1) << TempMax - (TempVerticalDivision * index) << "</text>" << std::endl;
-					if (DrawHumidity)
-						SVGFile << "\t<text style=\"fill:green;dominant-baseline:middle\" x=\"" << GraphRight + TickSize << "\" y=\"" << GraphTop + (GraphVerticalDivision * index) << "\">" << std::fixed << std::setprecision(1) << HumiMax - (HumiVerticalDivision * index) << "</text>" << std::endl;
-					if (DrawPressure)
-						SVGFile << "\t<text style=\"fill:purple;text-anchor:end;dominant-baseline:middle\" x=\"" << GraphRight + TickSize << "\" y=\"" << GraphTop + (GraphVerticalDivision * index) << "\">" << std::fixed << std::setprecision(1) << PressureMax - (PressureVerticalDivision * index) << "</text>" << std::endl;
-				}
-
-				// Horizontal Line drawn at the freezing point
-				if ((GraphTop < FreezingLine) && (FreezingLine < GraphBottom))
+				const GraphType graph(static_cast<GraphType>(Tier));
+				const MRTGTier<T> TheValues(MRTG, graph);
+				if (!TheValues.empty())
 				{
-					SVGFile << "\t<!-- FreezingLine = " << FreezingLine << " -->" << std::endl;
-					SVGFile << "\t<line style=\"fill:red;stroke:red;stroke-dasharray:1\" x1=\"" << GraphLeft - TickSize << "\" y1=\"" << FreezingLine << "\" x2=\"" << GraphRight + TickSize << "\" y2=\"" << FreezingLine << "\" />" << std::endl;
-				}
-
-				// Horizontal Division Dashed Lines
-				for (auto index = std::size_t(0); index < (GraphWidth < TheValues.size() ? GraphWidth : TheValues.size()); index++)
-				{
-					struct tm UTC;
-					if (0 != localtime_r(&TheValues[index].Time, &UTC))
+					SVGRanges Ranges;
+					for (auto const& Variant : SVGVariants)
 					{
-						if (graph == GraphType::daily)
-						{
-							if (UTC.tm_min == 0)
-							{
-								if (UTC.tm_hour == 0)
-									SVGFile << "\t<line style=\"stroke:red\" x1=\"" << GraphLeft + index << "\" y1=\"" << GraphTop << "\" x2=\"" << GraphLeft + index << "\" y2=\"" << GraphBottom + TickSize << "\" />" << std::endl;
-								else
-									SVGFile << "\t<line style=\"stroke-dasharray:1\" x1=\"" << GraphLeft + index << "\" y1=\"" << GraphTop << "\" x2=\"" << GraphLeft + index << "\" y2=\"" << GraphBottom + TickSize << "\" />" << std::endl;
-								if (UTC.tm_hour % 2 == 0)
-									SVGFile << "\t<text style=\"text-anchor:middle\" x=\"" << GraphLeft + index << "\" y=\"" << SVGHeight - 2 << "\">" << UTC.tm_hour << "</text>" << std::endl;
-							}
-						}
-						else if (graph == GraphType::weekly)
-						{
-							const std::string Weekday[] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
-							if ((UTC.tm_hour == 0) && (UTC.tm_min == 0))
-							{
-								if (UTC.tm_wday == 0)
-									SVGFile << "\t<line style=\"stroke:red\" x1=\"" << GraphLeft + index << "\" y1=\"" << GraphTop << "\" x2=\"" << GraphLeft + index << "\" y2=\"" << GraphBottom + TickSize << "\" />" << std::endl;
-								else
-									SVGFile << "\t<line style=\"stroke-dasharray:1\" x1=\"" << GraphLeft + index << "\" y1=\"" << GraphTop << "\" x2=\"" << GraphLeft + index << "\" y2=\"" << GraphBottom + TickSize << "\" />" << std::endl;
-							}
-							else if ((UTC.tm_hour == 12) && (UTC.tm_min == 0))
-								SVGFile << "\t<text style=\"text-anchor:middle\" x=\"" << GraphLeft + index << "\" y=\"" << SVGHeight - 2 << "\">" << Weekday[UTC.tm_wday] << "</text>" << std::endl;
-						}
-						else if (graph == GraphType::monthly)
-						{
-							if ((UTC.tm_mday == 1) && (UTC.tm_hour == 0) && (UTC.tm_min == 0))
-								SVGFile << "\t<line style=\"stroke:red\" x1=\"" << GraphLeft + index << "\" y1=\"" << GraphTop << "\" x2=\"" << GraphLeft + index << "\" y2=\"" << GraphBottom + TickSize << "\" />" << std::endl;
-							if ((UTC.tm_wday == 0) && (UTC.tm_hour == 0) && (UTC.tm_min == 0))
-								SVGFile << "\t<line style=\"stroke-dasharray:1\" x1=\"" << GraphLeft + index << "\" y1=\"" << GraphTop << "\" x2=\"" << GraphLeft + index << "\" y2=\"" << GraphBottom + TickSize << "\" />" << std::endl;
-							else if ((UTC.tm_wday == 3) && (UTC.tm_hour == 12) && (UTC.tm_min == 0))
-								SVGFile << "\t<text style=\"text-anchor:middle\" x=\"" << GraphLeft + index << "\" y=\"" << SVGHeight - 2 << "\">Week " << UTC.tm_yday / 7 + 1 << "</text>" << std::endl;
-						}
-						else if (graph == GraphType::yearly)
+						std::filesystem::path OutputPath(SVGDirectory / (FileStem + (Variant.Name.empty() ? "" : "-" + Variant.Name) + GraphSuffix[Tier]));
+						if (SVGNeedsWriting(TheValues, OutputPath, ssTitle))
 						{
-							const std::string Month[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
-							if ((UTC.tm_yday == 0) && (UTC.tm_mday == 1) && (UTC.tm_hour == 0) && (UTC.tm_min == 0))
-								SVGFile << "\t<line style=\"stroke:red\" x1=\"" << GraphLeft + index << "\" y1=\"" << GraphTop << "\" x2=\"" << GraphLeft + index << "\" y2=\"" << GraphBottom + TickSize << "\" />" << std::endl;
-							else if ((UTC.tm_mday == 1) && (UTC.tm_hour == 0) && (UTC.tm_min == 0))
-								SVGFile << "\t<line style=\"stroke-dasharray:1\" x1=\"" << GraphLeft + index << "\" y1=\"" << GraphTop << "\" x2=\"" << GraphLeft + index << "\" y2=\"" << GraphBottom + TickSize << "\" />" << std::endl;
-							else if ((UTC.tm_mday == 15) && (UTC.tm_hour == 0) && (UTC.tm_min == 0))
-								SVGFile << "\t<text style=\"text-anchor:middle\" x=\"" << GraphLeft + index << "\" y=\"" << SVGHeight - 2 << "\">" << Month[UTC.tm_mon] << "</text>" << std::endl;
+							if (SVGWorkers.empty())
+								ReplaceSVG(TheValues, Ranges, OutputPath, ssTitle, graph, Variant);
+							else
+								JobOutputs.push_back(std::make_pair(OutputPath, Variant));
 						}
 					}
-				}
-
-				// Directional Arrow
-				SVGFile << "\t<polygon style=\"fill:red;stroke:red;fill-opacity:1;\" points=\"" << GraphLeft - 3 << "," << GraphBottom << " " << GraphLeft + 3 << "," << GraphBottom - 3 << " " << GraphLeft + 3 << "," << GraphBottom + 3 << "\" />" << std::endl;
-
-				if (MinMax)
-				{
-					// Pressure Values as a filled polygon showing the minimum and maximum
-					if (DrawPressure)
+					if (!JobOutputs.empty())
 					{
-						SVGFile << "\t<!-- Pressure MinMax -->" << std::endl;
-						SVGFile << "\t<polygon style=\"fill:purple;stroke:purple;clip-path:url(#GraphRegion)\" points=\"";
-						for (auto index = 1; index < (GraphWidth < TheValues.size() ? GraphWidth : TheValues.size()); index++)
-							SVGFile << index + GraphLeft << "," << int(((PressureMax - TheValues[index].GetPressureMax()) * PressureVerticalFactor) + GraphTop) << " ";
-						for (auto index = (GraphWidth < TheValues.size() ? GraphWidth : TheValues.size()) - 1; index > 0; index--)
-							SVGFile << index + GraphLeft << "," << int(((PressureMax - TheValues[index].GetPressureMin()) * PressureVerticalFactor) + GraphTop) << " ";
-						SVGFile << "\" />" << std::endl;
+						TheValues.CopyTo(JobValues);	// the workers draw after this thread has moved on and updated the tiers
+						QueueSVG(JobValues, JobOutputs, SVGDirectory / (FileStem + GraphSuffix[Tier]), ssTitle, graph);
+						JobOutputs.clear();
 					}
-					// Temperature Values as a filled polygon showing the minimum and maximum
-					SVGFile << "\t<!-- Temperature MinMax -->" << std::endl;
-					SVGFile << "\t<polygon style=\"fill:blue;stroke:blue;clip-path:url(#GraphRegion)\" points=\"";
-					for (auto index = std::size_t(1); index < (GraphWidth < TheValues.size() ? GraphWidth : TheValues.size()); index++)
-						SVGFile << index + GraphLeft << "," << int(((TempMax - TheValues[index].GetTemperatureMax(Fahrenheit)) * TempVerticalFactor) + GraphTop) << " ";
-					for (auto index = (GraphWidth < TheValues.size() ? GraphWidth : TheValues.size()) - 1; index > 0; index--)
-						SVGFile << index + GraphLeft << "," << int(((TempMax - TheValues[index].GetTemperatureMin(Fahrenheit)) * TempVerticalFactor) + GraphTop) << " ";
-					SVGFile << "\" />" << std::endl;
 				}
-				else
+				Written.first->second.Tier[Tier] = Generation.Tier[Tier];
+			}
+		}
+		PerfStats.DeviceSVG.Add(PerfStart);
+	}
+}
+template <typename T> void WriteAllSVG(const std::map<bdaddr_t, std::vector<T>>& MRTGLogs)
+{
+	ReadTitleMap(SVGTitleMapFilename);
+	for (auto const& [TheAddress, MRTG] : MRTGLogs)
+		WriteDeviceSVG(TheAddress, MRTG);
+}
+/////////////////////////////////////////////////////////////////////////////
+// A small HTTP/1.1 server so the graphs can be viewed without writing every SVG file to disk every five minutes and running a separate web server.
+// A graph is only rendered when it's requested, and the rendered output is kept until the tier it's drawn from has a newer sample.
+// Requests are handled on the main thread between Bluetooth events. Client sockets never block: each client only gets what it has already sent read,
+// and a response is sent as fast as the client takes it, so one slow client can't hold up the loop.
+int HTTPSocket(-1);
+struct HTTPConnection
+{
+	std::string Request;	// bytes received that aren't a complete request yet
+	std::string Response;	// bytes of responses the client hasn't taken yet
+	bool bClose = false;	// close once Response has been sent
+	time_t LastActive;
+};
+std::map<int, HTTPConnection> HTTPConnections;
+const size_t HTTP_MAX_CONNECTIONS(16);
+const time_t HTTP_IDLE_TIMEOUT(30);		// seconds a connection may sit without sending a request or taking any of its response
+const size_t HTTP_MAX_REQUEST(8192);	// longest request head accepted
+const size_t HTTP_MAX_RESPONSE(16 * 1024 * 1024);	// most response bytes held for a client that isn't reading
+struct RenderedFile
+{
+	time_t Time;	// newest sample in the tier when it was rendered
+	std::string Title;
+	std::string ContentType;
+	std::string ETag;
+	std::string Body;
+	std::string GzipETag;
+	std::string GzipBody;	// compressed once when rendered, sent to clients that accept gzip
+};
+std::map<std::string, RenderedFile> RenderedFiles;	// keyed by the request path
+bool OpenHTTPSocket(void)
+{
+	bool rval = false;
+	if (!HTTPListen.empty())
+	{
+		std::string Address("127.0.0.1");	// only reachable from this machine unless an address is given
+		std::string Port(HTTPListen);
+		auto pos = HTTPListen.rfind(':');
+		if (pos != std::string::npos)
+		{
+			Address = HTTPListen.substr(0, pos);
+			Port = HTTPListen.substr(pos + 1);
+			if ((Address.size() > 1) && (Address.front() == '[') && (Address.back() == ']'))	// [::1]:8080
+				Address = Address.substr(1, Address.size() - 2);
+		}
+		struct addrinfo hints({ 0 });
+		hints.ai_family = AF_UNSPEC;
+		hints.ai_socktype = SOCK_STREAM;
+		hints.ai_flags = AI_PASSIVE | AI_NUMERICSERV;
+		struct addrinfo* res = NULL;
+		if (0 == getaddrinfo(Address.empty() ? NULL : Address.c_str(), Port.c_str(), &hints, &res))
+		{
+			for (struct addrinfo* ai = res; (ai != NULL) && (HTTPSocket < 0); ai = ai->ai_next)
+			{
+				HTTPSocket = socket(ai->ai_family, ai->ai_socktype | SOCK_NONBLOCK | SOCK_CLOEXEC, ai->ai_protocol);
+				if (HTTPSocket >= 0)
 				{
-					// Pressure Values as a continuous line
-					if (DrawPressure)
+					int on = 1;
+					setsockopt(HTTPSocket, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+					if ((0 != bind(HTTPSocket, ai->ai_addr, ai->ai_addrlen)) || (0 != listen(HTTPSocket, 16)))
 					{
-						SVGFile << "\t<!-- Pressure -->" << std::endl;
-						SVGFile << "\t<polyline style=\"fill:none;stroke:purple;clip-path:url(#GraphRegion)\" points=\"";
-						for (auto index = 1; index < (GraphWidth < TheValues.size() ? GraphWidth : TheValues.size()); index++)
-							SVGFile << index + GraphLeft << "," << int(((PressureMax - TheValues[index].GetPressure()) * PressureVerticalFactor) + GraphTop) << " ";
-						SVGFile << "\" />" << std::endl;
+						close(HTTPSocket);
+						HTTPSocket = -1;
 					}
-					// Temperature Values as a continuous line
-					SVGFile << "\t<!-- Temperature -->" << std::endl;
-					SVGFile << "\t<polyline style=\"fill:none;stroke:blue;clip-path:url(#GraphRegion)\" points=\"";
-					for (auto index = std::size_t(1); index < (GraphWidth < TheValues.size() ? GraphWidth : TheValues.size()); index++)
-						SVGFile << index + GraphLeft << "," << int(((TempMax - TheValues[index].GetTemperature(Fahrenheit)) * TempVerticalFactor) + GraphTop) << " ";
-					SVGFile << "\" />" << std::endl;
-				}
-
-				// Battery Values as a continuous line
-				if (DrawBattery)
-				{
-					SVGFile << "\t<!-- Battery -->" << std::endl;
-					double BatteryVerticalFactor = (GraphBottom - GraphTop) / 100.0;
-					SVGFile << "\t<polyline style=\"fill:none;stroke:OrangeRed;clip-path:url(#GraphRegion)\" points=\"";
-					for (auto index = std::size_t(1); index < (GraphWidth < TheValues.size() ? GraphWidth : TheValues.size()); index++)
-						SVGFile << index + GraphLeft << "," << int(((100 - TheValues[index].GetBattery()) * BatteryVerticalFactor) + GraphTop) << " ";
-					SVGFile << "\" />" << std::endl;
 				}
-
-				if (DrawPressure)
-					if (graph != GraphType::daily) // this text was way too busy on the daily graph
-					{
-						SVGFile << "\t<text class=\"barometer-label\" x=\"50%\" y=\"" << int(((PressureMax - 974) * PressureVerticalFactor) + GraphTop) << "\">Rain</text>" << std::endl;
-						SVGFile << "\t<text class=\"barometer-label\" x=\"50%\" y=\"" << int(((PressureMax - 999) * PressureVerticalFactor) + GraphTop) << "\">Change</text>" << std::endl;
-						SVGFile << "\t<text class=\"barometer-label\" x=\"50%\" y=\"" << int(((PressureMax - 1024) * PressureVerticalFactor) + GraphTop) << "\">Fair</text>" << std::endl;
-					}
-
-				SVGFile << "</svg>" << std::endl;
-				SVGFile.close();
-				struct utimbuf SVGut({ 0 });
-				SVGut.actime = TheValues.begin()->Time;
-				SVGut.modtime = TheValues.begin()->Time;
-				utime(SVGFileName.c_str(), &SVGut);
 			}
+			freeaddrinfo(res);
+		}
+		if (HTTPSocket >= 0)
+		{
+			if (ConsoleVerbosity > 0)
+				std::cout << "[" << getTimeISO8601(true) << "] Listening: http://" << (Address.find(':') == std::string::npos ? Address : "[" + Address + "]") << ":" << Port << "/" << std::endl;
+			rval = true;
 		}
+		else
+			std::cerr << "Error: Unable to listen on " << HTTPListen << " " << strerror(errno) << std::endl;
 	}
+	return(rval);
 }
-// Takes a Bluetooth address and current datapoint and updates the mapped structure in memory simulating the contents of a MRTG log file.
-template <typename T> void UpdateMRTGData(const bdaddr_t& TheAddress, const T& TheValue, std::map<bdaddr_t, std::vector<T>>& MRTGLogs)
+void CloseHTTPSocket(void)
 {
-	if (TheValue.IsValid())	// Sanity Check
+	for (auto const& [HTTPClient, Connection] : HTTPConnections)
+		close(HTTPClient);
+	HTTPConnections.clear();
+	if (HTTPSocket >= 0)
 	{
-		std::vector<T> foo;
-		auto ret = MRTGLogs.insert(std::pair<bdaddr_t, std::vector<T>>(TheAddress, foo));
-		std::vector<T>& FakeMRTGFile = ret.first->second;
-		if (FakeMRTGFile.empty())
+		close(HTTPSocket);
+		HTTPSocket = -1;
+	}
+}
+// RFC 7231 dates, which are always in GMT and use English names regardless of locale.
+std::string HTTPDate(const time_t TheTime)
+{
+	static const char* const Days[7] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+	static const char* const Months[12] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun", "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+	struct tm UTC;
+	gmtime_r(&TheTime, &UTC);
+	std::ostringstream rval;
+	rval << Days[UTC.tm_wday] << ", " << std::setfill('0') << std::setw(2) << UTC.tm_mday << " " << Months[UTC.tm_mon] << " " << UTC.tm_year + 1900 << " "
+		<< std::setw(2) << UTC.tm_hour << ":" << std::setw(2) << UTC.tm_min << ":" << std::setw(2) << UTC.tm_sec << " GMT";
+	return(rval.str());
+}
+time_t HTTPDate(const std::string& TheDate)
+{
+	time_t rval = 0;
+	struct tm UTC({ 0 });
+	const char* end = strptime(TheDate.c_str(), "%a, %d %b %Y %H:%M:%S GMT", &UTC);
+	if ((end != NULL) && (*end == '\0'))
+		rval = timegm(&UTC);
+	return(rval);
+}
+// Keeps a compressed copy and the tags for both, so neither is worked out again until the contents change.
+void SetRenderedBody(RenderedFile& Rendered, const std::string& Body)
+{
+	Rendered.Body = Body;
+	std::ostringstream ETag;
+	ETag << "\"" << std::hex << std::setfill('0') << std::setw(8) << crc32(crc32(0L, Z_NULL, 0), reinterpret_cast<const Bytef*>(Rendered.Body.data()), Rendered.Body.size()) << "\"";
+	Rendered.ETag = ETag.str();
+	Rendered.GzipBody = GzipString(Rendered.Body);
+	Rendered.GzipETag = Rendered.ETag.substr(0, Rendered.ETag.size() - 1) + "-gzip\"";	// a different representation needs its own tag
+}
+// Renders a graph only when the tier it's drawn from has changed since the last time it was asked for. Returns NULL if there's nothing to draw.
+template <typename T> const RenderedFile* GetRenderedSVG(const std::string& Path, const bdaddr_t& TheAddress, const GraphType graph, const SVGVariant& Variant, const std::map<bdaddr_t, std::vector<T>>& MRTGLogs)
+{
+	const RenderedFile* rval = NULL;
+	auto it = MRTGLogs.find(TheAddress);
+	if ((it != MRTGLogs.end()) && (!it->second.empty()))
+	{
+		const std::vector<T>& MRTG(it->second);
+		const int Tier(static_cast<int>(graph));
+		// The day graph is labeled with the time of the most recent reading, the others with their newest sample
+		const time_t TierTime(graph == GraphType::daily ? MRTG[0].Time : MRTG[MRTG_TIER_FIRST[Tier]].Time);
+		if (!SVGTitleMapFilename.empty())
+			ReadTitleMap(SVGTitleMapFilename);
+		const std::string Title(GetSVGTitle(TheAddress, GetMRTGModel(TheAddress, MRTG)));
+		RenderedFile& Rendered(RenderedFiles[Path]);
+		if (Rendered.Body.empty() || (Rendered.Time != TierTime) || (Rendered.Title != Title))
 		{
-			FakeMRTGFile.resize(2 + DAY_COUNT + WEEK_COUNT + MONTH_COUNT + YEAR_COUNT);
-			FakeMRTGFile[0] = TheValue;	// current value
-			FakeMRTGFile[1] = TheValue;
-			for (auto index = std::size_t(0); index < DAY_COUNT; index++)
-				FakeMRTGFile[index + 2].Time = FakeMRTGFile[index + 1].Time - DAY_SAMPLE;
-			for (auto index = std::size_t(0); index < WEEK_COUNT; index++)
-				FakeMRTGFile[index + 2 + DAY_COUNT].Time = FakeMRTGFile[index + 1 + DAY_COUNT].Time - WEEK_SAMPLE;
-			for (auto index = std::size_t(0); index < MONTH_COUNT; index++)
-				FakeMRTGFile[index + 2 + DAY_COUNT + WEEK_COUNT].Time = FakeMRTGFile[index + 1 + DAY_COUNT + WEEK_COUNT].Time - MONTH_SAMPLE;
-			for (auto index = std::size_t(0); index < YEAR_COUNT; index++)
-				FakeMRTGFile[index + 2 + DAY_COUNT + WEEK_COUNT + MONTH_COUNT].Time = FakeMRTGFile[index + 1 + DAY_COUNT + WEEK_COUNT + MONTH_COUNT].Time - YEAR_SAMPLE;
+			TRACE_SCOPE("SVG render");
+			const MRTGTier<T> TheValues(MRTG, graph);
+			SVGRanges Ranges;
+			FormatBuffer SVGFile(SVG_RESERVE);
+			WriteSVG(TheValues, Ranges, SVGFile, Title, graph, Variant);
+			LoggerStats.SVGRenders++;
+			Rendered.Time = TierTime;
+			Rendered.Title = Title;
+			Rendered.ContentType = "image/svg+xml";
+			SetRenderedBody(Rendered, SVGFile.str());
+			if (ConsoleVerbosity > 1)
+				std::cout << "[" << getTimeISO8601(true) << "] Rendered: " << Path << " With Title: " << Title << std::endl;
 		}
-		else
+		if (!Rendered.Body.empty())
+			rval = &Rendered;
+	}
+	return(rval);
+}
+// The data of all four tiers, made again when a new sample has arrived.
+template <typename T> const RenderedFile* GetRenderedJSON(const std::string& Path, const bdaddr_t& TheAddress, const std::map<bdaddr_t, std::vector<T>>& MRTGLogs)
+{
+	const RenderedFile* rval = NULL;
+	auto it = MRTGLogs.find(TheAddress);
+	if ((it != MRTGLogs.end()) && (!it->second.empty()))
+	{
+		const std::vector<T>& MRTG(it->second);
+		if (!SVGTitleMapFilename.empty())
+			ReadTitleMap(SVGTitleMapFilename);
+		const ThermometerType Model(GetMRTGModel(TheAddress, MRTG));
+		const std::string Title(GetSVGTitle(TheAddress, Model));
+		RenderedFile& Rendered(RenderedFiles[Path]);
+		if (Rendered.Body.empty() || (Rendered.Time != MRTG[0].Time) || (Rendered.Title != Title))
 		{
-			if (TheValue.Time > FakeMRTGFile[0].Time)
-			{
-				FakeMRTGFile[0] = TheValue;	// current value
-				FakeMRTGFile[1] += TheValue; // averaged value up to DAY_SAMPLE size
-			}
+			Rendered.Time = MRTG[0].Time;
+			Rendered.Title = Title;
+			Rendered.ContentType = "application/json";
+			SetRenderedBody(Rendered, GetMRTGJSON(TheAddress, Model, MRTG, Title));
 		}
-		bool ZeroAccumulator = false;
-		auto DaySampleFirst = FakeMRTGFile.begin() + 2;
-		auto DaySampleLast = FakeMRTGFile.begin() + 1 + DAY_COUNT;
-		auto WeekSampleFirst = FakeMRTGFile.begin() + 2 + DAY_COUNT;
-		auto WeekSampleLast = FakeMRTGFile.begin() + 1 + DAY_COUNT + WEEK_COUNT;
-		auto MonthSampleFirst = FakeMRTGFile.begin() + 2 + DAY_COUNT + WEEK_COUNT;
-		auto MonthSampleLast = FakeMRTGFile.begin() + 1 + DAY_COUNT + WEEK_COUNT + MONTH_COUNT;
-		auto YearSampleFirst = FakeMRTGFile.begin() + 2 + DAY_COUNT + WEEK_COUNT + MONTH_COUNT;
-		auto YearSampleLast = FakeMRTGFile.begin() + 1 + DAY_COUNT + WEEK_COUNT + MONTH_COUNT + YEAR_COUNT;
-		// For every time difference between FakeMRTGFile[1] and FakeMRTGFile[2] that's greater than DAY_SAMPLE we shift that data towards the back.
-		while (difftime(FakeMRTGFile[1].Time, DaySampleFirst->Time) > DAY_SAMPLE)
+		rval = &Rendered;
+	}
+	return(rval);
+}
+// Prometheus label values escape backslash, double quote and newline.
+std::string PrometheusLabel(const std::string& Text)
+{
+	std::string rval;
+	for (auto const& c : Text)
+	{
+		if (c == '\\')
+			rval += "\\\\";
+		else if (c == '"')
+			rval += "\\\"";
+		else if (c == '\n')
+			rval += "\\n";
+		else
+			rval += c;
+	}
+	return(rval);
+}
+// Meat thermometers report a temperature for each probe, in the same order they're logged.
+int GoveeProbes(const ThermometerType Model)
+{
+	int rval = 1;
+	if ((Model == ThermometerType::H5181) || (Model == ThermometerType::H5183))
+		rval = 2;
+	else if ((Model == ThermometerType::H5182) || (Model == ThermometerType::H5184))
+		rval = 4;
+	return(rval);
+}
+// Model names are printed in parentheses everywhere else.
+std::string PrometheusModel(const ThermometerType Model)
+{
+	std::string rval(ThermometerType2String(Model));
+	if ((rval.size() > 2) && (rval.front() == '(') && (rval.back() == ')'))
+		rval = rval.substr(1, rval.size() - 2);
+	return(rval);
+}
+// The most recent readings and the logger's own counters in the Prometheus text exposition format, built from memory on every request.
+std::string PrometheusMetrics(void)
+{
+	time_t TimeNow;
+	time(&TimeNow);
+	std::ostringstream ssMetrics;
+	std::map<bdaddr_t, std::string> Labels;
+	for (auto const& [TheAddress, TheValue] : GoveeLastReading)
+		Labels[TheAddress] = "address=\"" + ba2string(TheAddress) + "\",model=\"" + PrometheusModel(TheValue.GetModel()) + "\"";
+	for (auto const& [TheAddress, TheValue] : RuuviLastReading)
+		Labels[TheAddress] = "address=\"" + ba2string(TheAddress) + "\",model=\"" + PrometheusModel(TheValue.GetModel()) + "\"";
+	for (auto const& [TheAddress, TheTitle] : GoveeBluetoothTitles)
+	{
+		auto it = Labels.find(TheAddress);
+		if (it != Labels.end())
+			it->second += ",title=\"" + PrometheusLabel(TheTitle) + "\"";
+	}
+	ssMetrics << "# HELP govee_temperature_celsius Most recent temperature. Meat thermometers report one per probe.\n";
+	ssMetrics << "# TYPE govee_temperature_celsius gauge\n";
+	for (auto const& [TheAddress, TheValue] : GoveeLastReading)
+		for (auto Probe = 0; Probe < GoveeProbes(TheValue.GetModel()); Probe++)
+			ssMetrics << "govee_temperature_celsius{" << Labels[TheAddress] << ",probe=\"" << Probe << "\"} " << TheValue.GetTemperature(false, Probe) << "\n";
+	ssMetrics << "# HELP govee_humidity_percent Most recent relative humidity.\n";
+	ssMetrics << "# TYPE govee_humidity_percent gauge\n";
+	for (auto const& [TheAddress, TheValue] : GoveeLastReading)
+		if (GoveeProbes(TheValue.GetModel()) == 1)	// meat thermometers don't measure humidity
+			ssMetrics << "govee_humidity_percent{" << Labels[TheAddress] << "} " << TheValue.GetHumidity() << "\n";
+	ssMetrics << "# HELP govee_battery_percent Most recent battery level.\n";
+	ssMetrics << "# TYPE govee_battery_percent gauge\n";
+	for (auto const& [TheAddress, TheValue] : GoveeLastReading)
+		ssMetrics << "govee_battery_percent{" << Labels[TheAddress] << "} " << TheValue.GetBattery() << "\n";
+	ssMetrics << "# HELP ruuvi_temperature_celsius Most recent temperature.\n";
+	ssMetrics << "# TYPE ruuvi_temperature_celsius gauge\n";
+	for (auto const& [TheAddress, TheValue] : RuuviLastReading)
+		ssMetrics << "ruuvi_temperature_celsius{" << Labels[TheAddress] << "} " << TheValue.GetTemperature() << "\n";
+	ssMetrics << "# HELP ruuvi_humidity_percent Most recent relative humidity.\n";
+	ssMetrics << "# TYPE ruuvi_humidity_percent gauge\n";
+	for (auto const& [TheAddress, TheValue] : RuuviLastReading)
+		ssMetrics << "ruuvi_humidity_percent{" << Labels[TheAddress] << "} " << TheValue.GetHumidity() << "\n";
+	ssMetrics << "# HELP ruuvi_pressure_hpa Most recent air pressure.\n";
+	ssMetrics << "# TYPE ruuvi_pressure_hpa gauge\n";
+	for (auto const& [TheAddress, TheValue] : RuuviLastReading)
+		ssMetrics << "ruuvi_pressure_hpa{" << Labels[TheAddress] << "} " << TheValue.GetPressure() << "\n";
+	ssMetrics << "# HELP ruuvi_battery_volts Most recent battery voltage.\n";
+	ssMetrics << "# TYPE ruuvi_battery_volts gauge\n";
+	for (auto const& [TheAddress, TheValue] : RuuviLastReading)
+		ssMetrics << "ruuvi_battery_volts{" << Labels[TheAddress] << "} " << TheValue.GetBattery() << "\n";
+	ssMetrics << "# HELP goveebttemplogger_device_readings_total Readings decoded from advertisements since the logger started.\n";
+	ssMetrics << "# TYPE goveebttemplogger_device_readings_total counter\n";
+	for (auto const& [TheAddress, Stats] : DeviceStats)
+		ssMetrics << "goveebttemplogger_device_readings_total{" << Labels[TheAddress] << "} " << Stats.Readings << "\n";
+	ssMetrics << "# HELP goveebttemplogger_device_last_seen_age_seconds Seconds since the device was last heard from.\n";
+	ssMetrics << "# TYPE goveebttemplogger_device_last_seen_age_seconds gauge\n";
+	for (auto const& [TheAddress, Stats] : DeviceStats)
+		ssMetrics << "goveebttemplogger_device_last_seen_age_seconds{" << Labels[TheAddress] << "} " << difftime(TimeNow, Stats.LastSeen) << "\n";
+	ssMetrics << "# HELP goveebttemplogger_device_rssi_dbm Signal strength of the most recent advertisement that reported it.\n";
+	ssMetrics << "# TYPE goveebttemplogger_device_rssi_dbm gauge\n";
+	for (auto const& [TheAddress, Stats] : DeviceStats)
+		if (Stats.HasRSSI)
+			ssMetrics << "goveebttemplogger_device_rssi_dbm{" << Labels[TheAddress] << "} " << Stats.RSSI << "\n";
+	ssMetrics << "# HELP goveebttemplogger_start_time_seconds Time the logger started, in seconds since the epoch.\n";
+	ssMetrics << "# TYPE goveebttemplogger_start_time_seconds gauge\n";
+	ssMetrics << "goveebttemplogger_start_time_seconds " << LoggerStats.Started << "\n";
+	ssMetrics << "# HELP goveebttemplogger_advertisements_total HCI advertising reports and D-Bus property updates processed.\n";
+	ssMetrics << "# TYPE goveebttemplogger_advertisements_total counter\n";
+	ssMetrics << "goveebttemplogger_advertisements_total " << LoggerStats.Advertisements << "\n";
+	ssMetrics << "# HELP goveebttemplogger_log_lines_total Lines added to the log files.\n";
+	ssMetrics << "# TYPE goveebttemplogger_log_lines_total counter\n";
+	ssMetrics << "goveebttemplogger_log_lines_total " << LoggerStats.LogLines << "\n";
+	ssMetrics << "# HELP goveebttemplogger_cache_writes_total Cache files rewritten and cache journal appends.\n";
+	ssMetrics << "# TYPE goveebttemplogger_cache_writes_total counter\n";
+	ssMetrics << "goveebttemplogger_cache_writes_total{kind=\"snapshot\"} " << LoggerStats.CacheSnapshots << "\n";
+	ssMetrics << "goveebttemplogger_cache_writes_total{kind=\"journal\"} " << LoggerStats.CacheJournalAppends << "\n";
+	ssMetrics << "# HELP goveebttemplogger_svg_files_written_total Graphs written to the SVG directory.\n";
+	ssMetrics << "# TYPE goveebttemplogger_svg_files_written_total counter\n";
+	ssMetrics << "goveebttemplogger_svg_files_written_total " << LoggerStats.SVGFiles << "\n";
+	ssMetrics << "# HELP goveebttemplogger_svg_renders_total Graphs rendered for HTTP requests.\n";
+	ssMetrics << "# TYPE goveebttemplogger_svg_renders_total counter\n";
+	ssMetrics << "goveebttemplogger_svg_renders_total " << LoggerStats.SVGRenders << "\n";
+	ssMetrics << "# HELP goveebttemplogger_http_requests_total HTTP requests answered.\n";
+	ssMetrics << "# TYPE goveebttemplogger_http_requests_total counter\n";
+	ssMetrics << "goveebttemplogger_http_requests_total " << LoggerStats.HTTPRequests << "\n";
+	ssMetrics << "# HELP goveebttemplogger_mrtg_queries_total Queries answered on the query socket.\n";
+	ssMetrics << "# TYPE goveebttemplogger_mrtg_queries_total counter\n";
+	ssMetrics << "goveebttemplogger_mrtg_queries_total " << LoggerStats.Queries << "\n";
+	ssMetrics << "# HELP goveebttemplogger_devices Devices with data held in memory for graphs.\n";
+	ssMetrics << "# TYPE goveebttemplogger_devices gauge\n";
+	ssMetrics << "goveebttemplogger_devices{kind=\"govee\"} " << GoveeMRTGLogs.size() << "\n";
+	ssMetrics << "goveebttemplogger_devices{kind=\"ruuvi\"} " << RuuviMRTGLogs.size() << "\n";
+	return(ssMetrics.str());
+}
+// True if an Accept-Encoding header lists gzip without giving it a quality of zero. Content codings are case insensitive.
+bool HTTPAcceptsGzip(const std::string& AcceptEncoding)
+{
+	bool rval = false;
+	std::string Codings(AcceptEncoding);
+	std::transform(Codings.begin(), Codings.end(), Codings.begin(), ::tolower);
+	std::istringstream ssCodings(Codings);
+	std::string Coding;
+	while (std::getline(ssCodings, Coding, ','))
+	{
+		Coding.erase(std::remove_if(Coding.begin(), Coding.end(), ::isspace), Coding.end());
+		const std::string Name(Coding.substr(0, Coding.find(';')));
+		if ((Name == "gzip") || (Name == "*"))
 		{
-			ZeroAccumulator = true;
-			// shuffle all the day samples toward the end
-			std::copy_backward(DaySampleFirst, DaySampleLast - 1, DaySampleLast);
-			*DaySampleFirst = FakeMRTGFile[1];
-			DaySampleFirst->NormalizeTime(T::granularity::day);
-			if (difftime(DaySampleFirst->Time, (DaySampleFirst + 1)->Time) > DAY_SAMPLE)
-				DaySampleFirst->Time = (DaySampleFirst + 1)->Time + DAY_SAMPLE;
-			if (DaySampleFirst->GetTimeGranularity() == T::granularity::year)
-			{
-				if (ConsoleVerbosity > 5)
-					std::cout << "[" << getTimeISO8601(true) << "] shuffling year " << timeToExcelLocal(DaySampleFirst->Time) << " > " << timeToExcelLocal(YearSampleFirst->Time) << std::endl;
-				// shuffle all the year samples toward the end
-				std::copy_backward(YearSampleFirst, YearSampleLast - 1, YearSampleLast);
-				*YearSampleFirst = T();
-				for (auto iter = DaySampleFirst; (iter->IsValid() && ((iter - DaySampleFirst) < (12 * 24))); iter++) // One Day of day samples
-					*YearSampleFirst += *iter;
-			}
-			if ((DaySampleFirst->GetTimeGranularity() == T::granularity::year) ||
-				(DaySampleFirst->GetTimeGranularity() == T::granularity::month))
-			{
-				if (ConsoleVerbosity > 5)
-					std::cout << "[" << getTimeISO8601(true) << "] shuffling month " << timeToExcelLocal(DaySampleFirst->Time) << std::endl;
-				// shuffle all the month samples toward the end
-				std::copy_backward(MonthSampleFirst, MonthSampleLast - 1, MonthSampleLast);
-				*MonthSampleFirst = T();
-				for (auto iter = DaySampleFirst; (iter->IsValid() && ((iter - DaySampleFirst) < (12 * 2))); iter++) // two hours of day samples
-					*MonthSampleFirst += *iter;
-			}
-			if ((DaySampleFirst->GetTimeGranularity() == T::granularity::year) ||
-				(DaySampleFirst->GetTimeGranularity() == T::granularity::month) ||
-				(DaySampleFirst->GetTimeGranularity() == T::granularity::week))
+			double Quality = 1;
+			auto pos = Coding.find(";q=");
+			if (pos != std::string::npos)
 			{
-				if (ConsoleVerbosity > 5)
-					std::cout << "[" << getTimeISO8601(true) << "] shuffling week " << timeToExcelLocal(DaySampleFirst->Time) << std::endl;
-				// shuffle all the month samples toward the end
-				std::copy_backward(WeekSampleFirst, WeekSampleLast - 1, WeekSampleLast);
-				*WeekSampleFirst = T();
-				for (auto iter = DaySampleFirst; (iter->IsValid() && ((iter - DaySampleFirst) < 6)); iter++) // Half an hour of day samples
-					*WeekSampleFirst += *iter;
+				try { Quality = std::stod(Coding.substr(pos + 3)); }
+				catch (const std::exception& e) { Quality = 0; }
 			}
-		}
-		if (ZeroAccumulator)
-		{
-			FakeMRTGFile[1] = T();
+			if (Name == "gzip")
+				rval = Quality > 0;
+			else if (Codings.find("gzip") == std::string::npos)	// * only counts when gzip isn't named
+				rval = Quality > 0;
 		}
 	}
+	return(rval);
 }
-void ReadLoggedData(const std::filesystem::path& filename)
+// Builds the response to one request head. Returns false if the connection should be closed once the response is sent.
+bool HTTPResponse(const std::string& RequestHead, std::string& Response)
 {
-	const std::regex ModifiedBluetoothAddressRegex("[[:xdigit:]]{12}");
-	std::smatch BluetoothAddressInFilename;
-	std::string Stem(filename.stem().string());
-	if (std::regex_search(Stem, BluetoothAddressInFilename, ModifiedBluetoothAddressRegex))
+	bool rval = false;
+	std::istringstream ssRequest(RequestHead);
+	std::string Method, Target, Version;
+	std::string IfNoneMatch, IfModifiedSince, Connection, AcceptEncoding;
+	std::getline(ssRequest, Method, ' ');
+	std::getline(ssRequest, Target, ' ');
+	std::getline(ssRequest, Version, '\r');
+	std::string HeaderLine;
+	while (std::getline(ssRequest, HeaderLine))
 	{
-		bdaddr_t TheBlueToothAddress(string2ba(BluetoothAddressInFilename.str()));
-
-		// Only read the file if it's newer than what we may have cached
-		bool bReadFile = true;
-		struct stat64 FileStat({ 0 });
-		if (0 == stat64(filename.c_str(), &FileStat))	// returns 0 if the file-status information is obtained
+		if (!HeaderLine.empty() && (HeaderLine.back() == '\r'))
+			HeaderLine.pop_back();
+		auto colon = HeaderLine.find(':');
+		if (colon != std::string::npos)
 		{
-			auto it1 = GoveeMRTGLogs.find(TheBlueToothAddress);
-			if (it1 != GoveeMRTGLogs.end())
-				if (!it1->second.empty())
-					if (FileStat.st_mtim.tv_sec < (it1->second.begin()->Time))	// only read the file if it more recent than existing data
-						bReadFile = false;
-			auto it2 = RuuviMRTGLogs.find(TheBlueToothAddress);
-			if (it2 != RuuviMRTGLogs.end())
-				if (!it2->second.empty())
-					if (FileStat.st_mtim.tv_sec < (it2->second.begin()->Time))	// only read the file if it more recent than existing data
-						bReadFile = false;
+			std::string Name(HeaderLine.substr(0, colon));
+			std::transform(Name.begin(), Name.end(), Name.begin(), ::tolower);
+			auto ValueStart = HeaderLine.find_first_not_of(" \t", colon + 1);
+			const std::string Value(ValueStart == std::string::npos ? "" : HeaderLine.substr(ValueStart));
+			if (Name == "if-none-match")
+				IfNoneMatch = Value;
+			else if (Name == "if-modified-since")
+				IfModifiedSince = Value;
+			else if (Name == "connection")
+				Connection = Value;
+			else if (Name == "accept-encoding")
+				AcceptEncoding = Value;
 		}
-
-		if (bReadFile)
+	}
+	std::transform(Connection.begin(), Connection.end(), Connection.begin(), ::tolower);
+	const bool bAcceptGzip(HTTPAcceptsGzip(AcceptEncoding));
+	const std::string Path(Target.substr(0, Target.find('?')));
+	std::string Status("200 OK");
+	std::ostringstream Headers;
+	std::string Body;
+	const RenderedFile* Rendered = NULL;
+	if ((Version != "HTTP/1.1") && (Version != "HTTP/1.0"))
+		Status = "400 Bad Request";
+	else
+	{
+		rval = (Version == "HTTP/1.1") && (Connection.find("close") == std::string::npos);
+		if ((Method != "GET") && (Method != "HEAD"))
 		{
-			if (ConsoleVerbosity > 0)
-				std::cout << "[" << getTimeISO8601(true) << "] Reading: " << filename.string() << std::endl;
-			else
-				std::cerr << "Reading: " << filename.string() << std::endl;
-			std::ifstream TheFile(filename);
-			if (TheFile.is_open())
+			Status = "405 Method Not Allowed";
+			Headers << "Allow: GET, HEAD\r\n";
+			rval = false;	// any request body hasn't been read
+		}
+		else
+		{
+			static const std::regex SVGPathRegex("/(gvh|ruuvi)-([[:xdigit:]]{12})(-[[:alnum:]_]+)?-(day|week|month|year)\\.svg");
+			static const std::regex JSONPathRegex("/(gvh|ruuvi)-([[:xdigit:]]{12})\\.json");
+			std::smatch SVGPathMatch;
+			if (Path == "/metrics")
 			{
-				ThermometerType CacheThermometerType = ThermometerType::Unknown;
-				auto foo = GoveeThermometers.find(TheBlueToothAddress);
-				if (foo != GoveeThermometers.end())
-					CacheThermometerType = foo->second;
-
-				std::vector<std::string> SortableFile;
-				std::string RawLine;
-				while (std::getline(TheFile, RawLine))
-					SortableFile.push_back(RawLine);
-				TheFile.close();
-				sort(SortableFile.begin(), SortableFile.end());
-				const std::regex GoveeFileRegex("gvh-[[:xdigit:]]{12}-[[:digit:]]{4}-[[:digit:]]{2}.txt");
-				const std::regex RuuviFileRegex("ruuvi-[[:xdigit:]]{12}-[[:digit:]]{4}-[[:digit:]]{2}.txt");
-				if (std::regex_match(filename.filename().string(), GoveeFileRegex))
-					for (auto const& SortedLine : SortableFile)
-					{
-						Govee_Temp TheValue(SortedLine);
-						if (TheValue.GetModel() == ThermometerType::Unknown)
-							TheValue.SetModel(CacheThermometerType);
-						if (TheValue.IsValid())
-							UpdateMRTGData(TheBlueToothAddress, TheValue, GoveeMRTGLogs);
-					}
-				else if (std::regex_match(filename.filename().string(), RuuviFileRegex))
-					for (auto const& SortedLine : SortableFile)
-					{
-						Ruuvi_Tag TheValue(SortedLine);
-						if (TheValue.IsValid())
-							UpdateMRTGData(TheBlueToothAddress, TheValue, RuuviMRTGLogs);
-					}
+				Headers << "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n";
+				Headers << "Cache-Control: no-store\r\n";
+				Body = PrometheusMetrics();
+			}
+			else if ((Path == "/") || (Path == "/viewer.html"))
+			{
+				std::set<std::string> FileStems;
+				for (auto const& [TheAddress, MRTG] : GoveeMRTGLogs)
+					if (!MRTG.empty())
+						FileStems.insert(GetFileStem(TheAddress, GetMRTGModel(TheAddress, MRTG)));
+				for (auto const& [TheAddress, MRTG] : RuuviMRTGLogs)
+					if (!MRTG.empty())
+						FileStems.insert(GetFileStem(TheAddress, GetMRTGModel(TheAddress, MRTG)));
+				Headers << "Content-Type: text/html; charset=utf-8\r\n";
+				Headers << "Cache-Control: no-cache\r\n";
+				Body = GetViewerHTML(FileStems);
+			}
+			else if (std::regex_match(Path, SVGPathMatch, JSONPathRegex))
+			{
+				const bdaddr_t TheAddress(string2ba(SVGPathMatch[2].str()));
+				if (SVGPathMatch[1] == "ruuvi")
+					Rendered = GetRenderedJSON(Path, TheAddress, RuuviMRTGLogs);
+				else
+					Rendered = GetRenderedJSON(Path, TheAddress, GoveeMRTGLogs);
+			}
+			else if (std::regex_match(Path, SVGPathMatch, SVGPathRegex))
+			{
+				const bdaddr_t TheAddress(string2ba(SVGPathMatch[2].str()));
+				GraphType graph(GraphType::daily);
+				if (SVGPathMatch[4] == "week")
+					graph = GraphType::weekly;
+				else if (SVGPathMatch[4] == "month")
+					graph = GraphType::monthly;
+				else if (SVGPathMatch[4] == "year")
+					graph = GraphType::yearly;
+				const std::string VariantName(SVGPathMatch[3].length() > 0 ? SVGPathMatch[3].str().substr(1) : "");
+				auto Variant = SVGVariants.begin();
+				while ((Variant != SVGVariants.end()) && (Variant->Name != VariantName))
+					Variant++;
+				if (Variant == SVGVariants.end())
+					Rendered = NULL;
+				else if (SVGPathMatch[1] == "ruuvi")
+					Rendered = GetRenderedSVG(Path, TheAddress, graph, *Variant, RuuviMRTGLogs);
+				else
+					Rendered = GetRenderedSVG(Path, TheAddress, graph, *Variant, GoveeMRTGLogs);
+			}
+			if (Body.empty() && (Rendered == NULL))
+				Status = "404 Not Found";
+			else if (Rendered != NULL)
+			{
+				const bool bGzip(bAcceptGzip && !Rendered->GzipBody.empty());
+				const std::string& ETag(bGzip ? Rendered->GzipETag : Rendered->ETag);
+				Headers << "Content-Type: " << Rendered->ContentType << "\r\n";
+				if (bGzip)
+					Headers << "Content-Encoding: gzip\r\n";
+				Headers << "Vary: Accept-Encoding\r\n";
+				Headers << "ETag: " << ETag << "\r\n";
+				Headers << "Last-Modified: " << HTTPDate(Rendered->Time) << "\r\n";
+				Headers << "Cache-Control: no-cache\r\n";	// browsers revalidate, which is answered with 304 until the tier changes
+				bool NotModified = false;
+				if (!IfNoneMatch.empty())
+					NotModified = (IfNoneMatch == "*") || (IfNoneMatch.find(ETag) != std::string::npos);
+				else if (!IfModifiedSince.empty())
+					NotModified = HTTPDate(IfModifiedSince) >= Rendered->Time;
+				if (NotModified)
+					Status = "304 Not Modified";
+				else
+					Body = bGzip ? Rendered->GzipBody : Rendered->Body;
 			}
 		}
 	}
+	if (Status.front() == '4')
+	{
+		Headers << "Content-Type: text/plain\r\n";
+		Body = Status + "\n";
+	}
+	std::ostringstream ssResponse;
+	ssResponse << "HTTP/1.1 " << Status << "\r\n";
+	ssResponse << "Date: " << HTTPDate(time(NULL)) << "\r\n";
+	ssResponse << "Server: " << ProgramVersionString << "\r\n";
+	ssResponse << Headers.str();
+	if (Status.front() != '3')
+		ssResponse << "Content-Length: " << Body.size() << "\r\n";
+	ssResponse << "Connection: " << (rval ? "keep-alive" : "close") << "\r\n";
+	ssResponse << "\r\n";
+	if (Method != "HEAD")
+		ssResponse << Body;
+	Response = ssResponse.str();
+	LoggerStats.HTTPRequests++;
+	if (ConsoleVerbosity > 1)
+		std::cout << "[" << getTimeISO8601(true) << "] HTTP: " << Method << " " << Target << " " << Status << std::endl;
+	return(rval);
 }
-// Finds log files specific to this program then reads the contents into the memory mapped structure simulating MRTG log files.
-void ReadLoggedData(void)
+// Sends as much of the pending response as the client's socket will take right now. Returns false once the connection should be closed.
+bool SendHTTPConnection(const int HTTPClient, HTTPConnection& Connection)
 {
-	const std::regex LogFileRegex("(gvh|ruuvi)-[[:xdigit:]]{12}-[[:digit:]]{4}-[[:digit:]]{2}.txt");
-	if (!LogDirectory.empty())
+	bool rval = true;
+	if (!Connection.Response.empty())
 	{
-		if (ConsoleVerbosity > 1)
-			std::cout << "[" << getTimeISO8601(true) << "] ReadLoggedData: " << LogDirectory << std::endl;
-		std::deque<std::filesystem::path> files;
-		for (auto const& dir_entry : std::filesystem::directory_iterator{ LogDirectory })
-			if (dir_entry.is_regular_file())
-				if (std::regex_match(dir_entry.path().filename().string(), LogFileRegex))
-					files.push_back(dir_entry);
-		if (!files.empty())
+		ssize_t bufDataLen = send(HTTPClient, Connection.Response.data(), Connection.Response.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+		if (bufDataLen > 0)
 		{
-			sort(files.begin(), files.end());
-			while (!files.empty())
-			{
-				ReadLoggedData(*files.begin());
-				files.pop_front();
-			}
+			time(&Connection.LastActive);
+			Connection.Response.erase(0, bufDataLen);
 		}
+		else if ((errno != EAGAIN) && (errno != EWOULDBLOCK))
+			rval = false;
 	}
+	if (Connection.bClose && Connection.Response.empty())
+		rval = false;
+	return(rval);
 }
-void MonitorLoggedData(const int SecondsRecent = 35*60)
+// Reads whatever a client has sent and answers each complete request in it. Returns false once the connection should be closed.
+bool ServiceHTTPConnection(const int HTTPClient, HTTPConnection& Connection)
 {
-	if (!LogDirectory.empty())
+	bool rval = true;
+	char buf[4096];
+	ssize_t bufDataLen = recv(HTTPClient, buf, sizeof(buf), MSG_DONTWAIT);
+	if (bufDataLen > 0)
 	{
-		for (auto it = GoveeMRTGLogs.begin(); it != GoveeMRTGLogs.end(); it++)
+		time(&Connection.LastActive);
+		Connection.Request.append(buf, bufDataLen);
+		for (auto pos = Connection.Request.find("\r\n\r\n"); !Connection.bClose && (pos != std::string::npos); pos = Connection.Request.find("\r\n\r\n"))
 		{
-			std::filesystem::path filename(GenerateLogFileName(it->first));
-			struct stat64 FileStat({ 0 });
-			if (0 == stat64(filename.c_str(), &FileStat))	// returns 0 if the file-status information is obtained
-				if (!it->second.empty())
-					if (FileStat.st_mtim.tv_sec > (it->second.begin()->Time + (SecondsRecent)))	// only read the file if it's at least thirty five minutes more recent than existing data
-						ReadLoggedData(filename);
+			std::string Response;
+			Connection.bClose = !HTTPResponse(Connection.Request.substr(0, pos), Response);
+			Connection.Request.erase(0, pos + 4);
+			Connection.Response.append(Response);
 		}
+		if ((Connection.Request.size() > HTTP_MAX_REQUEST) || (Connection.Response.size() > HTTP_MAX_RESPONSE))
+			rval = false;	// a client pipelining requests faster than it reads the answers
+		else
+			rval = SendHTTPConnection(HTTPClient, Connection);
 	}
+	else if ((bufDataLen == 0) || ((errno != EAGAIN) && (errno != EWOULDBLOCK)))
+		rval = false;
+	return(rval);
 }
-bool ReadTitleMap(const std::filesystem::path& TitleMapFilename)
+// Adds every listening socket and connected client to the sets about to be passed to select(), so the caller wakes when any of them has something to read,
+// or when a client that hasn't taken all of its response can take more.
+int AddServerSockets(fd_set& check_set, fd_set& write_set, int MaxHandle)
 {
-	bool rval = false;
-	static time_t LastModified = 0;
-	struct stat64 TitleMapFileStat({ 0 });
-	if (0 == stat64(TitleMapFilename.c_str(), &TitleMapFileStat))
+	if (QuerySocket >= 0)
 	{
-		rval = true;
-		if (TitleMapFileStat.st_mtim.tv_sec > LastModified)	// only read the file if it's modified
+		FD_SET(QuerySocket, &check_set);
+		MaxHandle = std::max(MaxHandle, QuerySocket);
+	}
+	for (auto const& [QueryClient, Connection] : QueryConnections)
+	{
+		if (Connection.Answer.empty())
+			FD_SET(QueryClient, &check_set);
+		else
+			FD_SET(QueryClient, &write_set);
+		MaxHandle = std::max(MaxHandle, QueryClient);
+	}
+	if (HTTPSocket >= 0)
+	{
+		FD_SET(HTTPSocket, &check_set);
+		MaxHandle = std::max(MaxHandle, HTTPSocket);
+	}
+	for (auto const& [HTTPClient, Connection] : HTTPConnections)
+	{
+		if (Connection.Response.empty())
+			FD_SET(HTTPClient, &check_set);
+		else
+			FD_SET(HTTPClient, &write_set);	// more requests aren't read until the client has taken the answers it already has
+		MaxHandle = std::max(MaxHandle, HTTPClient);
+	}
+	return(MaxHandle);
+}
+// Answers whatever is waiting on the query and HTTP sockets and sends pending responses without blocking, and drops clients that have been idle too long.
+// A client that stops reading its response is idle too, so it's dropped after the same timeout instead of holding its connection forever.
+void ServiceServerSockets(void)
+{
+	if ((QuerySocket >= 0) || (HTTPSocket >= 0))
+	{
+		fd_set check_set, write_set;
+		FD_ZERO(&check_set);
+		FD_ZERO(&write_set);
+		int MaxHandle = AddServerSockets(check_set, write_set, -1);
+		struct timeval select_timeout = { 0, 0 };
+		if (0 < select(MaxHandle + 1, &check_set, &write_set, NULL, &select_timeout))
 		{
-			std::ifstream TheFile(TitleMapFilename);
-			if (TheFile.is_open())
+			for (auto it = QueryConnections.begin(); it != QueryConnections.end();)
 			{
-				LastModified = TitleMapFileStat.st_mtim.tv_sec;	// only update our time if the file is actually read
-				if (ConsoleVerbosity > 0)
-					std::cout << "[" << getTimeISO8601(true) << "] Reading: " << TitleMapFilename.string() << std::endl;
+				if ((FD_ISSET(it->first, &check_set) && !ServiceQueryConnection(it->first, it->second)) ||
+					(FD_ISSET(it->first, &write_set) && !SendQueryConnection(it->first, it->second)))
+				{
+					close(it->first);
+					it = QueryConnections.erase(it);
+				}
 				else
-					std::cerr << "Reading: " << TitleMapFilename.string() << std::endl;
-				std::string TheLine;
-
-				while (std::getline(TheFile, TheLine))
+					it++;
+			}
+			if ((QuerySocket >= 0) && FD_ISSET(QuerySocket, &check_set))
+				ServiceQuerySocket();
+			for (auto it = HTTPConnections.begin(); it != HTTPConnections.end();)
+			{
+				if ((FD_ISSET(it->first, &check_set) && !ServiceHTTPConnection(it->first, it->second)) ||
+					(FD_ISSET(it->first, &write_set) && !SendHTTPConnection(it->first, it->second)))
 				{
-					std::smatch BluetoothAddress;
-					if (std::regex_search(TheLine, BluetoothAddress, BluetoothAddressRegex))
+					close(it->first);
+					it = HTTPConnections.erase(it);
+				}
+				else
+					it++;
+			}
+			if ((HTTPSocket >= 0) && FD_ISSET(HTTPSocket, &check_set))
+			{
+				int HTTPClient;
+				while ((HTTPClient = accept4(HTTPSocket, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0)
+				{
+					if (HTTPConnections.size() < HTTP_MAX_CONNECTIONS)
 					{
-						bdaddr_t TheBlueToothAddress(string2ba(BluetoothAddress.str()));
-						const std::string delimiters(" \t");
-						auto i = TheLine.find_first_of(delimiters);		// Find first delimiter
-						i = TheLine.find_first_not_of(delimiters, i);	// Move past consecutive delimiters
-						std::string theTitle = (i == std::string::npos) ? "" : TheLine.substr(i);
-						GoveeBluetoothTitles.insert(std::make_pair(TheBlueToothAddress, theTitle));
+						HTTPConnection Connection;
+						time(&Connection.LastActive);
+						HTTPConnections.insert(std::pair<int, HTTPConnection>(HTTPClient, Connection));
 					}
+					else
+						close(HTTPClient);
 				}
-				TheFile.close();
 			}
 		}
+		time_t TimeNow;
+		time(&TimeNow);
+		for (auto it = QueryConnections.begin(); it != QueryConnections.end();)
+		{
+			if (difftime(TimeNow, it->second.LastActive) > QUERY_IDLE_TIMEOUT)
+			{
+				close(it->first);
+				it = QueryConnections.erase(it);
+			}
+			else
+				it++;
+		}
+		for (auto it = HTTPConnections.begin(); it != HTTPConnections.end();)
+		{
+			if (difftime(TimeNow, it->second.LastActive) > HTTP_IDLE_TIMEOUT)
+			{
+				close(it->first);
+				it = HTTPConnections.erase(it);
+			}
+			else
+				it++;
+		}
 	}
-	return(rval);
 }
-template <typename T> void WriteAllSVG(const std::map<bdaddr_t, std::vector<T>>& MRTGLogs)
+// Watches the log directory with inotify, replays only the log files that have been written, and rewrites the graphs for just those devices.
+// Returns false immediately if the watch can't be set up, so the caller can fall back to polling on a timer. Otherwise returns true once bRun has been cleared.
+bool MonitorLogDirectory(void)
 {
-	ReadTitleMap(SVGTitleMapFilename);
-	for (auto const& [TheAddress, MRTG] : MRTGLogs)
+	bool rval = false;
+	int InotifyHandle = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	if (InotifyHandle < 0)
+		std::cerr << "[" << getTimeISO8601(true) << "] Error: inotify_init1 " << strerror(errno) << std::endl;
+	else
 	{
-		if (!MRTG.empty())
+		int WatchHandle = inotify_add_watch(InotifyHandle, LogDirectory.c_str(), IN_MODIFY | IN_CLOSE_WRITE | IN_CREATE | IN_MOVED_TO);
+		if (WatchHandle < 0)
+			std::cerr << "[" << getTimeISO8601(true) << "] Error: inotify_add_watch " << LogDirectory << " " << strerror(errno) << std::endl;
+		else
 		{
-			std::string btAddress(ba2string(TheAddress));
-			for (auto pos = btAddress.find(':'); pos != std::string::npos; pos = btAddress.find(':'))
-				btAddress.erase(pos, 1);
-			ThermometerType CacheThermometerType = MRTG.front().GetModel();
-			if (CacheThermometerType == ThermometerType::Unknown)
+			rval = true;
+			if (ConsoleVerbosity > 0)
+				std::cout << "[" << getTimeISO8601(true) << "] Watching: " << LogDirectory << std::endl;
+			// bring every graph up to date once, after which only devices whose logs change are redrawn
+			WriteAllSVG(GoveeMRTGLogs);
+			WriteAllSVG(RuuviMRTGLogs);
+			const std::regex LogFileRegex("(gvh|ruuvi)-[[:xdigit:]]{12}-[[:digit:]]{4}-[[:digit:]]{2}.txt");
+			const std::regex ModifiedBluetoothAddressRegex("[[:xdigit:]]{12}");
+			std::set<std::string> ChangedFiles;
+			bool bOverflow = false;
+			time_t FirstChange = 0;
+			while (bRun)
 			{
-				auto foo = GoveeThermometers.find(TheAddress);
-				if (foo != GoveeThermometers.end())
-					CacheThermometerType = foo->second;
+				// With nothing pending, wait for the directory to change. Once something has changed, keep collecting events until the
+				// directory has been quiet for a second (or changes have been pending for five seconds) so a burst of writes is processed once.
+				// The idle timeout only bounds how long a signal arriving just before select() can go unnoticed, and how long connected clients can outstay their timeouts.
+				const bool bPending = bOverflow || !ChangedFiles.empty();
+				const bool bClients = !QueryConnections.empty() || !HTTPConnections.empty();
+				struct timeval select_timeout = { (bPending || bClients) ? 1 : 60, 0 };	// seconds, microseconds
+				fd_set check_set, write_set;
+				FD_ZERO(&check_set);
+				FD_ZERO(&write_set);
+				FD_SET(InotifyHandle, &check_set);
+				int ready = select(AddServerSockets(check_set, write_set, InotifyHandle) + 1, &check_set, &write_set, NULL, &select_timeout);	// returns -1 when interrupted by a signal
+				ServiceServerSockets();
+				ReportPerfStatistics();
+				if ((ready > 0) && FD_ISSET(InotifyHandle, &check_set))
+				{
+					alignas(struct inotify_event) char buf[4096];
+					ssize_t bufDataLen;
+					while ((bufDataLen = read(InotifyHandle, buf, sizeof(buf))) > 0)
+					{
+						for (char* ptr = buf; ptr < buf + bufDataLen;)
+						{
+							const struct inotify_event* event = reinterpret_cast<const struct inotify_event*>(ptr);
+							if (event->mask & IN_Q_OVERFLOW)
+								bOverflow = true;
+							else if ((event->len > 0) && std::regex_match(std::string(event->name), LogFileRegex))
+								ChangedFiles.insert(event->name);
+							ptr += sizeof(struct inotify_event) + event->len;
+						}
+					}
+					if ((FirstChange == 0) && (bOverflow || !ChangedFiles.empty()))
+						time(&FirstChange);
+				}
+				time_t TimeNow;
+				time(&TimeNow);
+				if ((bOverflow || !ChangedFiles.empty()) && ((ready == 0) || (difftime(TimeNow, FirstChange) >= 5)))
+				{
+					if (bOverflow)
+					{
+						// Events were lost, so we don't know which files changed. Check them all.
+						if (ConsoleVerbosity > 0)
+							std::cout << "[" << getTimeISO8601(true) << "] inotify queue overflowed, rereading: " << LogDirectory << std::endl;
+						ReadLoggedData();
+						WriteAllSVG(GoveeMRTGLogs);
+						WriteAllSVG(RuuviMRTGLogs);
+					}
+					else
+					{
+						std::set<bdaddr_t> ChangedDevices;
+						for (auto const& TheFileName : ChangedFiles)
+						{
+							std::smatch BluetoothAddressInFilename;
+							if (std::regex_search(TheFileName, BluetoothAddressInFilename, ModifiedBluetoothAddressRegex))
+							{
+								bdaddr_t TheBlueToothAddress(string2ba(BluetoothAddressInFilename.str()));
+								time_t StartTime = 0;	// a device we haven't seen yet gets its file read from the beginning
+								auto itGovee = GoveeMRTGLogs.find(TheBlueToothAddress);
+								if ((itGovee != GoveeMRTGLogs.end()) && !itGovee->second.empty())
+									StartTime = itGovee->second.begin()->Time;
+								auto itRuuvi = RuuviMRTGLogs.find(TheBlueToothAddress);
+								if ((itRuuvi != RuuviMRTGLogs.end()) && !itRuuvi->second.empty())
+									StartTime = itRuuvi->second.begin()->Time;
+								ReadLoggedData(LogDirectory / TheFileName, StartTime);
+								ChangedDevices.insert(TheBlueToothAddress);
+							}
+						}
+						ReadTitleMap(SVGTitleMapFilename);
+						for (auto const& TheBlueToothAddress : ChangedDevices)
+						{
+							auto itGovee = GoveeMRTGLogs.find(TheBlueToothAddress);
+							if (itGovee != GoveeMRTGLogs.end())
+								WriteDeviceSVG(itGovee->first, itGovee->second);
+							auto itRuuvi = RuuviMRTGLogs.find(TheBlueToothAddress);
+							if (itRuuvi != RuuviMRTGLogs.end())
+								WriteDeviceSVG(itRuuvi->first, itRuuvi->second);
+						}
+					}
+					ChangedFiles.clear();
+					bOverflow = false;
+					FirstChange = 0;
+				}
 			}
-			std::string ssTitle(btAddress + " " + ThermometerType2String(CacheThermometerType)); // default title
-			if (GoveeBluetoothTitles.find(TheAddress) != GoveeBluetoothTitles.end())
-				ssTitle = GoveeBluetoothTitles.find(TheAddress)->second;
-			std::filesystem::path OutputPath;
-			std::ostringstream OutputFilename;
-			OutputFilename.str("");
-			if (CacheThermometerType == ThermometerType::RUUVI)
-				OutputFilename << "ruuvi-";
-			else
-				OutputFilename << "gvh-";
-			OutputFilename << btAddress;
-			OutputFilename << "-day.svg";
-			OutputPath = SVGDirectory / OutputFilename.str();
-			std::vector<T> TheValues;
-			ReadMRTGData(MRTG, TheValues, GraphType::daily);
-			WriteSVG(TheValues, OutputPath, ssTitle, GraphType::daily, SVGFahrenheit, SVGBattery & 0x01, SVGMinMax & 0x01);
-			OutputFilename.str("");
-			if (CacheThermometerType == ThermometerType::RUUVI)
-				OutputFilename << "ruuvi-";
-			else
-				OutputFilename << "gvh-";
-			OutputFilename << btAddress;
-			OutputFilename << "-week.svg";
-			OutputPath = SVGDirectory / OutputFilename.str();
-			ReadMRTGData(MRTG, TheValues, GraphType::weekly);
-			WriteSVG(TheValues, OutputPath, ssTitle, GraphType::weekly, SVGFahrenheit, SVGBattery & 0x02, SVGMinMax & 0x02);
-			OutputFilename.str("");
-			if (CacheThermometerType == ThermometerType::RUUVI)
-				OutputFilename << "ruuvi-";
-			else
-				OutputFilename << "gvh-";
-			OutputFilename << btAddress;
-			OutputFilename << "-month.svg";
-			OutputPath = SVGDirectory / OutputFilename.str();
-			ReadMRTGData(MRTG, TheValues, GraphType::monthly);
-			WriteSVG(TheValues, OutputPath, ssTitle, GraphType::monthly, SVGFahrenheit, SVGBattery & 0x04, SVGMinMax & 0x04);
-			OutputFilename.str("");
-			if (CacheThermometerType == ThermometerType::RUUVI)
-				OutputFilename << "ruuvi-";
-			else
-				OutputFilename << "gvh-";
-			OutputFilename << btAddress;
-			OutputFilename << "-year.svg";
-			OutputPath = SVGDirectory / OutputFilename.str();
-			ReadMRTGData(MRTG, TheValues, GraphType::yearly);
-			WriteSVG(TheValues, OutputPath, ssTitle, GraphType::yearly, SVGFahrenheit, SVGBattery & 0x08, SVGMinMax & 0x08);
+			inotify_rm_watch(InotifyHandle, WatchHandle);
 		}
+		close(InotifyHandle);
 	}
+	return(rval);
 }
 void WriteSVGIndex(const std::filesystem::path LogDirectory, const std::filesystem::path SVGIndexFilename)
 {
-	const std::regex LogFileRegex("gvh-[[:xdigit:]]{12}-[[:digit:]]{4}-[[:digit:]]{2}.txt");
+	const std::regex LogFileRegex("gvh-[[:xdigit:]]{12}-[[:digit:]]{4}-[[:digit:]]{2}.txt(.gz)?");
 	if (!LogDirectory.empty())
 	{
 		if (ConsoleVerbosity > 0)
@@ -2776,59 +5642,72 @@ void WriteSVGIndex(const std::filesystem::path LogDirectory, const std::filesyst
 					}
 		if (!files.empty())
 		{
-			std::ofstream SVGIndexFile(SVGIndexFilename);
-			if (SVGIndexFile.is_open())
-			{
-				if (ConsoleVerbosity > 0)
-					std::cout << "[" << getTimeISO8601(true) << "] Writing: " << SVGIndexFilename << std::endl;
-				SVGIndexFile << "<!DOCTYPE HTML PUBLIC \"-//W3C//DTD HTML 4.01 Transitional//EN\" \"http://www.w3.org/TR/html4/loose.dtd\">" << std::endl;
-				SVGIndexFile << "<html>" << std::endl;
-				SVGIndexFile << "<head>" << std::endl;
-				SVGIndexFile << "\t<title>" << ProgramVersionString << "</title>" << std::endl;
-				SVGIndexFile << "\t<meta http-equiv=\"content-type\" content=\"text/html; charset=iso-8859-15\">" << std::endl;
-				SVGIndexFile << "\t<meta http-equiv=\"Refresh\" CONTENT=\"300\">" << std::endl;
-				SVGIndexFile << "\t<meta http-equiv=\"Cache-Control\" content=\"no-cache\">" << std::endl;
-				SVGIndexFile << "\t<meta http-equiv=\"Pragma\" CONTENT=\"no-cache\">" << std::endl;
-				SVGIndexFile << "\t<style type=\"text/css\">" << std::endl;
-				SVGIndexFile << "\t\tbody { color: black; }" << std::endl;
-				SVGIndexFile << "\t\t.image { float: left; position: relative; zoom: 85%; }" << std::endl;
-				SVGIndexFile << "\t\t@media only screen and (max-width: 980px) {" << std::endl;
-				SVGIndexFile << "\t\t\t.image { float: left; position: relative; zoom: 190%; }" << std::endl;
-				SVGIndexFile << "\t\t}" << std::endl;
-				SVGIndexFile << "\t</style>" << std::endl;
-				SVGIndexFile << "</head>" << std::endl;
-				SVGIndexFile << "<body>" << std::endl;
-				SVGIndexFile << "\t<div>" << std::endl;
-				SVGIndexFile << std::endl;
+			std::ostringstream SVGIndexFile;	// written with one write, and compressed as a whole with --gzip
+			if (ConsoleVerbosity > 0)
+				std::cout << "[" << getTimeISO8601(true) << "] Writing: " << SVGIndexFilename << std::endl;
+			SVGIndexFile << "<!DOCTYPE HTML PUBLIC \"-//W3C//DTD HTML 4.01 Transitional//EN\" \"http://www.w3.org/TR/html4/loose.dtd\">" << std::endl;
+			SVGIndexFile << "<html>" << std::endl;
+			SVGIndexFile << "<head>" << std::endl;
+			SVGIndexFile << "\t<title>" << ProgramVersionString << "</title>" << std::endl;
+			SVGIndexFile << "\t<meta http-equiv=\"content-type\" content=\"text/html; charset=iso-8859-15\">" << std::endl;
+			SVGIndexFile << "\t<meta http-equiv=\"Refresh\" CONTENT=\"300\">" << std::endl;
+			SVGIndexFile << "\t<meta http-equiv=\"Cache-Control\" content=\"no-cache\">" << std::endl;
+			SVGIndexFile << "\t<meta http-equiv=\"Pragma\" CONTENT=\"no-cache\">" << std::endl;
+			SVGIndexFile << "\t<style type=\"text/css\">" << std::endl;
+			SVGIndexFile << "\t\tbody { color: black; }" << std::endl;
+			SVGIndexFile << "\t\t.image { float: left; position: relative; zoom: 85%; }" << std::endl;
+			SVGIndexFile << "\t\t@media only screen and (max-width: 980px) {" << std::endl;
+			SVGIndexFile << "\t\t\t.image { float: left; position: relative; zoom: 190%; }" << std::endl;
+			SVGIndexFile << "\t\t}" << std::endl;
+			SVGIndexFile << "\t</style>" << std::endl;
+			SVGIndexFile << "</head>" << std::endl;
+			SVGIndexFile << "<body>" << std::endl;
+			SVGIndexFile << "\t<div>" << std::endl;
+			SVGIndexFile << std::endl;
+
+			SVGIndexFile << "\t<div>" << std::endl;
+			for (auto & ssBTAddress : files)
+				SVGIndexFile << "\t<a href=\"#" << ssBTAddress << "\">" << ssBTAddress << "</a>" << std::endl;
+			SVGIndexFile << "\t</div>" << std::endl;
+			SVGIndexFile << std::endl;
 
-				SVGIndexFile << "\t<div>" << std::endl;
-				for (auto & ssBTAddress : files)
-					SVGIndexFile << "\t<a href=\"#" << ssBTAddress << "\">" << ssBTAddress << "</a>" << std::endl;
+			if (ConsoleVerbosity > 0)
+				std::cout << "[" << getTimeISO8601(true) << "] Writing:";
+			for (auto & ssBTAddress : files)
+			{
+				SVGIndexFile << "\t<div id=\"" << ssBTAddress << "\">" << std::endl; 
+				SVGIndexFile << "\t<div class=\"image\"><img alt=\"" << ssBTAddress << "\" src=\"gvh-" << ssBTAddress << "-day.svg\" width=\"500\" height=\"135\"></div>" << std::endl;
+				SVGIndexFile << "\t<div class=\"image\"><img alt=\"" << ssBTAddress << "\" src=\"gvh-" << ssBTAddress << "-week.svg\" width=\"500\" height=\"135\"></div>" << std::endl;
+				SVGIndexFile << "\t<div class=\"image\"><img alt=\"" << ssBTAddress << "\" src=\"gvh-" << ssBTAddress << "-month.svg\" width=\"500\" height=\"135\"></div>" << std::endl;
+				SVGIndexFile << "\t<div class=\"image\"><img alt=\"" << ssBTAddress << "\" src=\"gvh-" << ssBTAddress << "-year.svg\" width=\"500\" height=\"135\"></div>" << std::endl;
 				SVGIndexFile << "\t</div>" << std::endl;
 				SVGIndexFile << std::endl;
-
-				if (ConsoleVerbosity > 0)
-					std::cout << "[" << getTimeISO8601(true) << "] Writing:";
-				for (auto & ssBTAddress : files)
-				{
-					SVGIndexFile << "\t<div id=\"" << ssBTAddress << "\">" << std::endl; 
-					SVGIndexFile << "\t<div class=\"image\"><img alt=\"" << ssBTAddress << "\" src=\"gvh-" << ssBTAddress << "-day.svg\" width=\"500\" height=\"135\"></div>" << std::endl;
-					SVGIndexFile << "\t<div class=\"image\"><img alt=\"" << ssBTAddress << "\" src=\"gvh-" << ssBTAddress << "-week.svg\" width=\"500\" height=\"135\"></div>" << std::endl;
-					SVGIndexFile << "\t<div class=\"image\"><img alt=\"" << ssBTAddress << "\" src=\"gvh-" << ssBTAddress << "-month.svg\" width=\"500\" height=\"135\"></div>" << std::endl;
-					SVGIndexFile << "\t<div class=\"image\"><img alt=\"" << ssBTAddress << "\" src=\"gvh-" << ssBTAddress << "-year.svg\" width=\"500\" height=\"135\"></div>" << std::endl;
-					SVGIndexFile << "\t</div>" << std::endl;
-					SVGIndexFile << std::endl;
-					if (ConsoleVerbosity > 0)
-						std::cout << " " << ssBTAddress;
-				}
 				if (ConsoleVerbosity > 0)
-					std::cout << std::endl;
-				SVGIndexFile << "\t</div>" << std::endl;
-				SVGIndexFile << "</body>" << std::endl;
-				SVGIndexFile << "</html>" << std::endl;
+					std::cout << " " << ssBTAddress;
+			}
+			if (ConsoleVerbosity > 0)
+				std::cout << std::endl;
+			SVGIndexFile << "\t</div>" << std::endl;
+			SVGIndexFile << "</body>" << std::endl;
+			SVGIndexFile << "</html>" << std::endl;
+			const time_t TimeNow(time(NULL));
+			if (ReplaceFile(SVGIndexFilename, SVGIndexFile.str(), TimeNow) && SVGGzip)
+				ReplaceGzipFile(SVGIndexFilename, SVGIndexFile.str(), TimeNow);
+			// The same graphs drawn in the browser from the files written with --json
+			if (JSONExport)
+			{
+				std::set<std::string> FileStems;
+				for (auto& ssBTAddress : files)
+					FileStems.insert("gvh-" + ssBTAddress);
+				const std::filesystem::path ViewerFilename(SVGIndexFilename.parent_path() / "viewer.html");
+				const std::string ViewerFile(GetViewerHTML(FileStems));
 				if (ConsoleVerbosity > 0)
-					std::cout << "[" << getTimeISO8601(true) << "] Done" << std::endl;
+					std::cout << "[" << getTimeISO8601(true) << "] Writing: " << ViewerFilename << std::endl;
+				if (ReplaceFile(ViewerFilename, ViewerFile, TimeNow) && SVGGzip)
+					ReplaceGzipFile(ViewerFilename, ViewerFile, TimeNow);
 			}
+			if (ConsoleVerbosity > 0)
+				std::cout << "[" << getTimeISO8601(true) << "] Done" << std::endl;
 		}
 	}
 }
@@ -3446,6 +6325,7 @@ const std::array<uint8_t, 16> PreSharedKey{ 0x4d, 0x61, 0x6b, 0x69, 0x6e, 0x67,
 //time_t BlueZ_HCI_ConnectAndDownload(int BlueToothDevice_Handle, const bdaddr_t GoveeBTAddress, const time_t GoveeLastReadTime = 0, int BatteryToRecord = 0)
 time_t BlueZ_HCI_ConnectAndDownload(int BlueToothDevice_Handle, Govee_Device & TheDevice, int BatteryToRecord = 0)
 {
+	TRACE_SCOPE("GATT connect");
 	const bdaddr_t GoveeBTAddress(TheDevice.GetMACAddress());
 	if (ConsoleVerbosity > 2)
 		std::cout << "[                   ] " << __func__ << " " << ba2string(GoveeBTAddress) << std::endl;
@@ -4233,6 +7113,7 @@ time_t BlueZ_HCI_ConnectAndDownload(int BlueToothDevice_Handle, Govee_Device & T
 									}
 									else if (buf[0] == BT_ATT_OP_HANDLE_VAL_NOT)
 									{
+										TRACE_SCOPE("download packet");
 										GATT_DataPacket *data = (GATT_DataPacket*)&(buf[0]);
 										GATT_DataPacketDecrypt(SessionKey, *data); // if SessionKey is zero this does nothing
 										if (ConsoleVerbosity > 1)
@@ -4586,8 +7467,10 @@ void BlueZ_HCI_MainLoop(std::string& ControllerAddress, std::set<bdaddr_t>& BT_W
 								fd_set check_set({ 0 });
 								FD_ZERO(&check_set);
 								FD_SET(BlueToothDevice_Handle, &check_set);
+								fd_set write_set({ 0 });	// HTTP clients with part of a response still to send
+								FD_ZERO(&write_set);
 								// This will block until either a read is ready (i.e. won’t return EWOULDBLOCK) -1 on error, 0 on timeout, otherwise number of FDs changed
-								if (0 < select(BlueToothDevice_Handle + 1, &check_set, NULL, NULL, &select_timeout))	// returns number of handles ready to read. 0 or negative indicate other than good data to read.
+								if (0 < select(AddServerSockets(check_set, write_set, BlueToothDevice_Handle) + 1, &check_set, &write_set, NULL, &select_timeout))	// returns number of handles ready to read. 0 or negative indicate other than good data to read.
 								{
 									// We got data ready to read, check and make sure it's the right descriptor, just as a sanity check (it shouldn't be possible ot get anything else)
 									if (FD_ISSET(BlueToothDevice_Handle, &check_set))
@@ -4595,7 +7478,9 @@ void BlueZ_HCI_MainLoop(std::string& ControllerAddress, std::set<bdaddr_t>& BT_W
 										// okay, if we made it this far, we can read our descriptor, and shouldn't get EAGAIN. Ideally, the right way to process this is 'read in a loop
 										// until you get EAGAIN and then go back to select()', but worst case is that you don't read everything availableand select() immediately returns, so not
 										// a *huge* deal just doing one read and then back to select, here.
+										TRACE_BEGIN("HCI read");
 										ssize_t bufDataLen = read(BlueToothDevice_Handle, buf, sizeof(buf));
+										TRACE_END("HCI read");
 										if (bufDataLen > HCI_MAX_EVENT_SIZE)
 											std::cerr << "[                   ] Error: bufDataLen (" << bufDataLen << ") > HCI_MAX_EVENT_SIZE (" << HCI_MAX_EVENT_SIZE << ")" << std::endl;
 										if (bufDataLen > (HCI_EVENT_HDR_SIZE + 1 + LE_ADVERTISING_INFO_SIZE))
@@ -4754,6 +7639,7 @@ void BlueZ_HCI_MainLoop(std::string& ControllerAddress, std::set<bdaddr_t>& BT_W
 																break;
 															case 0xFF:	// Manufacturer Specific Data
 																{
+																	TRACE_SCOPE("decode");
 																	const uint16_t ManufacturerID(uint16_t((info->data + current_offset + 1)[1]) | uint16_t((info->data + current_offset + 1)[2]) << 8);
 																	std::vector<uint8_t> ManufacturerData;
 																	for (auto index = 3; index < *(info->data + current_offset); index++)
@@ -4778,6 +7664,7 @@ void BlueZ_HCI_MainLoop(std::string& ControllerAddress, std::set<bdaddr_t>& BT_W
 																			if (foo != GoveeThermometers.end())
 																				localTemp.SetModel(foo->second);
 																		}
+																		CountDecode(localTemp.GetModel(), localTemp.IsValid());
 																		if ((TemperatureInAdvertisment = localTemp.IsValid()))
 																		{
 																			ConsoleOutLine << " " << localTemp.WriteConsole();
@@ -4785,21 +7672,35 @@ void BlueZ_HCI_MainLoop(std::string& ControllerAddress, std::set<bdaddr_t>& BT_W
 																			auto ret = GoveeTemperatures.insert(std::pair<bdaddr_t, std::queue<Govee_Temp>>(info->bdaddr, foo));
 																			ret.first->second.push(localTemp);	// puts the measurement in the queue to be written to the log file
 																			AddressInGoveeSet = true;
+																			TRACE_BEGIN("UpdateMRTGData");
+																			const auto PerfStart(std::chrono::steady_clock::now());
 																			UpdateMRTGData(info->bdaddr, localTemp, GoveeMRTGLogs);	// puts the measurement in the fake MRTG data structure
+																			PerfStats.UpdateMRTG.Add(PerfStart);
+																			TRACE_END("UpdateMRTGData");
 																			GoveeLastReading.insert_or_assign(info->bdaddr, localTemp);
 																		}
 																	}
 																	else if (localRuuvi.ReadMSG(ManufacturerID, ManufacturerData))
 																	{
 																		TemperatureInAdvertisment = localRuuvi.IsValid();
+																		CountDecode(ThermometerType::RUUVI, TemperatureInAdvertisment);
 																		std::queue<Ruuvi_Tag> foo;
 																		auto ret = RuuviTags.insert(std::pair<bdaddr_t, std::queue<Ruuvi_Tag>>(info->bdaddr, foo));
 																		ret.first->second.push(localRuuvi);	// puts the measurement in the queue to be written to the log file
 																		ConsoleOutLine << " " << localRuuvi.WriteConsole();
+																		TRACE_BEGIN("UpdateMRTGData");
+																		const auto PerfStart(std::chrono::steady_clock::now());
 																		UpdateMRTGData(info->bdaddr, localRuuvi, RuuviMRTGLogs);	// puts the measurement in the fake MRTG data structure
+																		PerfStats.UpdateMRTG.Add(PerfStart);
+																		TRACE_END("UpdateMRTGData");
+																		RuuviLastReading.insert_or_assign(info->bdaddr, localRuuvi);
+																	}
+																	else
+																	{
+																		CountDecode(localTemp.GetModel(), false);
+																		if (ConsoleVerbosity > 1)
+																			ConsoleOutLine << iBeacon(ManufacturerID, ManufacturerData);
 																	}
-																	else if (ConsoleVerbosity > 1)
-																		ConsoleOutLine << iBeacon(ManufacturerID, ManufacturerData);
 																}
 																break;
 															default:
@@ -4816,6 +7717,10 @@ void BlueZ_HCI_MainLoop(std::string& ControllerAddress, std::set<bdaddr_t>& BT_W
 												}
 												if ((TemperatureInAdvertisment && (ConsoleVerbosity > 0)) || (ConsoleVerbosity > 2))
 													std::cout << ConsoleOutLine.str() << std::endl;
+												// The signal strength is the byte following the advertising data
+												const bool bRSSI((info->data + info->length) < (buf + bufDataLen));
+												PerfStats.HCIAdvertisements++;
+												UpdateDeviceStatistics(info->bdaddr, TimeAdvertisment, TemperatureInAdvertisment, bRSSI, bRSSI ? int(int8_t(info->data[info->length])) : 0);
 												if (TemperatureInAdvertisment && (DaysBetweenDataDownload > 0) && AddressInGoveeSet && !LogDirectory.empty())
 												{
 													int BatteryToRecord(0);
@@ -4873,7 +7778,9 @@ void BlueZ_HCI_MainLoop(std::string& ControllerAddress, std::set<bdaddr_t>& BT_W
 											bRun = false;
 										}
 									}
+									ServiceServerSockets();
 								}
+								ReportPerfStatistics();
 								time_t TimeNow;
 								time(&TimeNow);
 								if ((!SVGDirectory.empty()) && (difftime(TimeNow, TimeSVG) > DAY_SAMPLE))
@@ -4893,7 +7800,9 @@ void BlueZ_HCI_MainLoop(std::string& ControllerAddress, std::set<bdaddr_t>& BT_W
 									GeneratePersistenceFile(GoveeThermometers, GoveeDevices);
 									GenerateCacheFile(GoveeMRTGLogs); // flush FakeMRTG data to cache files
 									GenerateLogFile(RuuviTags);
+									SyncLogFiles();
 									GenerateCacheFile(RuuviMRTGLogs); // flush FakeMRTG data to cache files
+									CompressClosedLogFiles();
 									if (bMonitorLoggingDirectory)
 										MonitorLoggedData();
 								}
@@ -4923,6 +7832,7 @@ void BlueZ_HCI_MainLoop(std::string& ControllerAddress, std::set<bdaddr_t>& BT_W
 			GenerateLogFile(GoveeTemperatures); // flush contents of accumulated map to logfiles
 			GeneratePersistenceFile(GoveeThermometers, GoveeDevices);
 			GenerateLogFile(RuuviTags); // flush contents of accumulated map to logfiles
+			SyncLogFiles(true);
 		}
 
 		if (ConsoleVerbosity > 1)
@@ -5325,6 +8235,7 @@ bool bluez_discovery(DBusConnection* dbus_conn, const char* adapter_path, const
 }
 void bluez_device_connect(DBusConnection* dbus_conn, const char* adapter_path, const bdaddr_t& dbusBTAddress)
 {
+	TRACE_SCOPE("GATT connect");
 	// this routine requests bluez connect to the device.
 	// I should then watch for a properties changed event ServicesResolved and find the services I want to connect to to download the data in a seperate routine.
 	std::ostringstream ssOutput;
@@ -5945,6 +8856,9 @@ std::string bluez_dbus_msg_iter(DBusMessageIter& array_iter, const bdaddr_t& dbu
 	std::ostringstream ssCompleteLine;
 	Govee_Temp localTemp;
 	Ruuvi_Tag localRuuvi;
+	bool bReading(false);
+	bool bRSSI(false);
+	int RSSI(0);
 	do
 	{
 		std::ostringstream ssStartLine;
@@ -5968,10 +8882,13 @@ std::string bluez_dbus_msg_iter(DBusMessageIter& array_iter, const bdaddr_t& dbu
 			{
 				dbus_message_iter_get_basic(&variant_iter, &value);
 				if (ConsoleVerbosity > 3) ssOutput << " " << Key << ": " << value.i16;
+				bRSSI = true;
+				RSSI = value.i16;
 			}
 		}
 		else if (!Key.compare("ManufacturerData"))
 		{
+			TRACE_SCOPE("decode");
 			if (DBUS_TYPE_ARRAY == dbus_message_Type)
 			{
 				bool bFirstData(true);
@@ -6053,11 +8970,17 @@ std::string bluez_dbus_msg_iter(DBusMessageIter& array_iter, const bdaddr_t& dbu
 										GoveeThermometers.insert_or_assign(dbusBTAddress, localTemp.GetModel());
 									if (localTemp.ReadMSG(ManufacturerID, ManufacturerData))
 									{
+										CountDecode(localTemp.GetModel(), localTemp.IsValid());
 										std::queue<Govee_Temp> foo;
 										auto ret = GoveeTemperatures.insert(std::pair<bdaddr_t, std::queue<Govee_Temp>>(dbusBTAddress, foo));
 										ret.first->second.push(localTemp);	// puts the measurement in the queue to be written to the log file
+										TRACE_BEGIN("UpdateMRTGData");
+										const auto PerfStart(std::chrono::steady_clock::now());
 										UpdateMRTGData(dbusBTAddress, localTemp, GoveeMRTGLogs);	// puts the measurement in the fake MRTG data structure
+										PerfStats.UpdateMRTG.Add(PerfStart);
+										TRACE_END("UpdateMRTGData");
 										GoveeLastReading.insert_or_assign(dbusBTAddress, localTemp);
+										bReading = true;
 										if (ConsoleVerbosity > 1)
 											ssOutput << " " << localTemp.WriteConsole();
 										// initiate connection here if we are set to download data
@@ -6092,10 +9015,19 @@ std::string bluez_dbus_msg_iter(DBusMessageIter& array_iter, const bdaddr_t& dbu
 										std::queue<Ruuvi_Tag> foo;
 										auto ret = RuuviTags.insert(std::pair<bdaddr_t, std::queue<Ruuvi_Tag>>(dbusBTAddress, foo));
 										ret.first->second.push(localRuuvi);	// puts the measurement in the queue to be written to the log file
+										TRACE_BEGIN("UpdateMRTGData");
+										const auto PerfStart(std::chrono::steady_clock::now());
 										UpdateMRTGData(dbusBTAddress, localRuuvi, RuuviMRTGLogs);	// puts the measurement in the fake MRTG data structure
+										PerfStats.UpdateMRTG.Add(PerfStart);
+										TRACE_END("UpdateMRTGData");
+										RuuviLastReading.insert_or_assign(dbusBTAddress, localRuuvi);
+										bReading = true;
+										CountDecode(ThermometerType::RUUVI, localRuuvi.IsValid());
 										if (ConsoleVerbosity > 1)
 											ssOutput << " " << localRuuvi.WriteConsole();
 									}
+									else
+										CountDecode(localTemp.GetModel(), false);
 								}
 							}
 						}
@@ -6282,6 +9214,7 @@ std::string bluez_dbus_msg_iter(DBusMessageIter& array_iter, const bdaddr_t& dbu
 				}
 				if (ValueData.size() == 20)
 				{
+					TRACE_SCOPE("download packet");
 					std::array<uint8_t, 20> packet;
 					for (auto index = 0; index < 20; index++)
 						packet[index] = ValueData[index];
@@ -6512,6 +9445,8 @@ std::string bluez_dbus_msg_iter(DBusMessageIter& array_iter, const bdaddr_t& dbu
 		if (!ssOutput.str().empty())
 			ssCompleteLine << ssStartLine.str() << ssOutput.str();
 	} while (dbus_message_iter_next(&array_iter));
+	UpdateDeviceStatistics(dbusBTAddress, TimeNow, bReading, bRSSI, RSSI);
+	PerfStats.DBusAdvertisements++;
 	return(ssCompleteLine.str());
 }
 void bluez_dbus_FindExistingDevices(DBusConnection* dbus_conn, const std::set<bdaddr_t>& BT_WhiteList)
@@ -6912,9 +9847,11 @@ int BlueZ_DBus_Mainloop(std::string& ControllerAddress, std::set<bdaddr_t>& BT_W
 								// If there is nothing to receive we get a NULL
 								if (dbus_msg != nullptr)
 								{
+									TRACE_SCOPE("D-Bus message");
 									if (DBUS_MESSAGE_TYPE_SIGNAL == dbus_message_get_type(dbus_msg))
 									{
 										const std::string dbus_msg_Member(dbus_message_get_member(dbus_msg)); // https://dbus.freedesktop.org/doc/api/html/group__DBusMessage.html#gaf5c6b705c53db07a5ae2c6b76f230cf9
+										PerfStats.DBusMembers[dbus_msg_Member]++;
 										bdaddr_t localBTAddress({ 0 });
 										if (!dbus_msg_Member.compare("InterfacesAdded"))
 											bluez_dbus_msg_InterfacesAdded(dbus_msg, localBTAddress, BT_WhiteList, TimeNow);
@@ -6966,6 +9903,8 @@ int BlueZ_DBus_Mainloop(std::string& ControllerAddress, std::set<bdaddr_t>& BT_W
 									dbus_message_unref(dbus_msg); // Free the message
 								}
 							}
+							ServiceServerSockets();	// dbus_connection_read_write waits at most a second, so queries are answered promptly
+							ReportPerfStatistics();
 							if ((!SVGDirectory.empty()) && (difftime(TimeNow, TimeSVG) > DAY_SAMPLE))
 							{
 								if (ConsoleVerbosity > 1)
@@ -7011,7 +9950,9 @@ int BlueZ_DBus_Mainloop(std::string& ControllerAddress, std::set<bdaddr_t>& BT_W
 								GeneratePersistenceFile(GoveeThermometers, GoveeDevices);
 								GenerateCacheFile(GoveeMRTGLogs); // flush FakeMRTG data to cache files
 								GenerateLogFile(RuuviTags);
+								SyncLogFiles();
 								GenerateCacheFile(RuuviMRTGLogs); // flush FakeMRTG data to cache files
+								CompressClosedLogFiles();
 								if (bMonitorLoggingDirectory)
 									MonitorLoggedData();
 								if (ConsoleVerbosity > 2)
@@ -7082,6 +10023,7 @@ int BlueZ_DBus_Mainloop(std::string& ControllerAddress, std::set<bdaddr_t>& BT_W
 	GenerateLogFile(GoveeTemperatures); // flush contents of accumulated map to logfiles
 	GeneratePersistenceFile(GoveeThermometers, GoveeDevices);
 	GenerateLogFile(RuuviTags); // flush contents of accumulated map to logfiles
+	SyncLogFiles(true);
 	return(rVal);
 }
 /////////////////////////////////////////////////////////////////////////////
@@ -7215,6 +10157,46 @@ bool rfkillUnblockBluetooth()
 	return(result);
 }
 /////////////////////////////////////////////////////////////////////////////
+// name:options, where the options are separated by commas and change the first variant: c (Celsius), f (Fahrenheit), b=graphs, x=graphs and WIDTHxHEIGHT.
+bool ParseSVGVariant(const std::string& Spec, SVGVariant& Variant)
+{
+	bool rval = false;
+	static const std::regex NameRegex("[[:alnum:]_]+");
+	static const std::regex SizeRegex("([[:digit:]]+)x([[:digit:]]+)");
+	const auto colon = Spec.find(':');
+	Variant.Name = Spec.substr(0, colon);
+	if (std::regex_match(Variant.Name, NameRegex))
+	{
+		rval = true;
+		std::istringstream ssOptions(colon == std::string::npos ? "" : Spec.substr(colon + 1));
+		std::string Option;
+		while (rval && std::getline(ssOptions, Option, ','))
+		{
+			std::smatch SizeMatch;
+			try
+			{
+				if (Option == "c")
+					Variant.Fahrenheit = false;
+				else if (Option == "f")
+					Variant.Fahrenheit = true;
+				else if (Option.substr(0, 2) == "b=")
+					Variant.Battery = std::stoi(Option.substr(2));
+				else if (Option.substr(0, 2) == "x=")
+					Variant.MinMax = std::stoi(Option.substr(2));
+				else if (std::regex_match(Option, SizeMatch, SizeRegex))
+				{
+					Variant.Width = std::stoul(SizeMatch[1].str());
+					Variant.Height = std::stoul(SizeMatch[2].str());
+					rval = (200 <= Variant.Width) && (Variant.Width <= 4000) && (60 <= Variant.Height) && (Variant.Height <= 2000);	// room for the legends and the axis labels
+				}
+				else
+					rval = false;
+			}
+			catch (const std::exception& e) { rval = false; }
+		}
+	}
+	return(rval);
+}
 static void usage(int argc, char **argv)
 {
 	std::cout << "Usage: " << argv[0] << " [options]" << std::endl;
@@ -7239,13 +10221,25 @@ static void usage(int argc, char **argv)
 	std::cout << "    -n | --no-bluetooth  Monitor Logging Directory and process logs without Bluetooth Scanning" << std::endl;
 	std::cout << "    -M | --monitor       Monitor Logging Directory" << std::endl;
 	std::cout << "    -r | --restart       Maximum minutes between Bluetooth advertisments [" << MaxMinutesBetweenBluetoothAdvertisments << "]" << std::endl;
+	std::cout << "    -z | --compress      Compress log files of completed months with gzip [" << std::boolalpha << CompressLogs << "]" << std::endl;
+	std::cout << "    -D | --durability level Sync log files after each write. 0:none, 1:log files, 2:log files and directory [" << LogDurability << "]" << std::endl;
+	std::cout << "    -S | --stage minutes Hold log data in memory up to this long before writing it [" << StagingMinutes << "]" << std::endl;
+	std::cout << "    -K | --stage-kb kilobytes Write staged log data early past this size [" << StagingKiloBytes << "]" << std::endl;
+	std::cout << "    -Q | --query-socket name Answer --mrtg queries on this Unix domain socket [" << QuerySocketPath << "]" << std::endl;
+	std::cout << "    -q | --query-mode mode Octal permissions of the query socket [" << std::oct << QuerySocketMode << std::dec << "]" << std::endl;
+	std::cout << "    -P | --stats minutes Print a line of performance statistics this often, SIGUSR1 prints everything [" << PerfStatsMinutes << "]" << std::endl;
+	std::cout << "    -w | --http [address:]port Serve SVG graphs and /metrics over HTTP, on 127.0.0.1 unless an address is given [" << HTTPListen << "]" << std::endl;
+	std::cout << "    -g | --gzip          Also write gzip compressed copies of SVG files and the index (.svg.gz) [" << std::boolalpha << SVGGzip << "]" << std::endl;
+	std::cout << "    -j | --svg-threads count Draw and write SVG files on this many worker threads [" << SVGThreads << "]" << std::endl;
+	std::cout << "    -J | --json          Also write the graph data as JSON for the viewer page drawn in the browser [" << std::boolalpha << JSONExport << "]" << std::endl;
+	std::cout << "    -V | --variant name:c,f,b=graph,x=graph,WIDTHxHEIGHT Also draw the SVG graphs this way, to files named gvh-XXXXXXXXXXXX-name-day.svg. May be repeated" << std::endl;
 #ifdef _BLUEZ_HCI_
 	std::cout << "    -H | --HCI           Prefer deprecated BlueZ HCI interface instead of DBus" << std::endl;
 	std::cout << "    -p | --passive       Bluetooth LE Passive Scanning" << std::endl;
 	#endif // _BLUEZ_HCI_
 	std::cout << std::endl;
 }
-static const char short_options[] = "hl:t:v:m:o:C:a:f:s:i:T:cb:x:d::pnHMR:";
+static const char short_options[] = "hl:t:v:m:o:C:a:f:s:i:T:cb:x:d::pnHMR:zD:S:K:Q:q:w:P:j:gJV:";
 static const struct option long_options[] = {
 		{ "help",   no_argument,       NULL, 'h' },
 		{ "log",    required_argument, NULL, 'l' },
@@ -7268,6 +10262,18 @@ static const struct option long_options[] = {
 		{ "HCI",	no_argument,       NULL, 'H' },
 		{ "monitor",no_argument,       NULL, 'M' },
 		{ "restart",required_argument, NULL, 'R' },
+		{ "compress",no_argument,      NULL, 'z' },
+		{ "durability",required_argument,NULL, 'D' },
+		{ "stage",	required_argument, NULL, 'S' },
+		{ "stage-kb",required_argument,NULL, 'K' },
+		{ "query-socket",required_argument,NULL, 'Q' },
+		{ "query-mode",required_argument,NULL, 'q' },
+		{ "http",	required_argument, NULL, 'w' },
+		{ "stats",	required_argument, NULL, 'P' },
+		{ "svg-threads",required_argument,NULL, 'j' },
+		{ "gzip",	no_argument,       NULL, 'g' },
+		{ "json",	no_argument,       NULL, 'J' },
+		{ "variant",required_argument, NULL, 'V' },
 		{ 0, 0, 0, 0 }
 };
 /////////////////////////////////////////////////////////////////////////////
@@ -7281,6 +10287,7 @@ int main(int argc, char **argv)
 	std::string MRTGAddress;
 	std::set<bdaddr_t> BT_WhiteList;
 	bdaddr_t OnlyFilterAddress = { 0 };
+	std::vector<std::string> SVGVariantSpecs;	// read once -c, -b and -x are known, wherever they are on the command line
 
 	int option(0);
 	while ((option = getopt_long(argc, argv, short_options, long_options, NULL)) != -1)
@@ -7393,15 +10400,83 @@ int main(int argc, char **argv)
 			catch (const std::invalid_argument& ia) { std::cerr << "Invalid argument: " << ia.what() << std::endl; exit(EXIT_FAILURE); }
 			catch (const std::out_of_range& oor) { std::cerr << "Out of Range error: " << oor.what() << std::endl; exit(EXIT_FAILURE); }
 			break;
+		case 'z':	// --compress
+			CompressLogs = true;
+			break;
+		case 'D':	// --durability
+			try { LogDurability = std::stoi(optarg); }
+			catch (const std::invalid_argument& ia) { std::cerr << "Invalid argument: " << ia.what() << std::endl; exit(EXIT_FAILURE); }
+			catch (const std::out_of_range& oor) { std::cerr << "Out of Range error: " << oor.what() << std::endl; exit(EXIT_FAILURE); }
+			break;
+		case 'S':	// --stage
+			try { StagingMinutes = std::stoi(optarg); }
+			catch (const std::invalid_argument& ia) { std::cerr << "Invalid argument: " << ia.what() << std::endl; exit(EXIT_FAILURE); }
+			catch (const std::out_of_range& oor) { std::cerr << "Out of Range error: " << oor.what() << std::endl; exit(EXIT_FAILURE); }
+			break;
+		case 'K':	// --stage-kb
+			try { StagingKiloBytes = std::stoul(optarg); }
+			catch (const std::invalid_argument& ia) { std::cerr << "Invalid argument: " << ia.what() << std::endl; exit(EXIT_FAILURE); }
+			catch (const std::out_of_range& oor) { std::cerr << "Out of Range error: " << oor.what() << std::endl; exit(EXIT_FAILURE); }
+			break;
+		case 'Q':	// --query-socket
+			QuerySocketPath = std::string(optarg);
+			break;
+		case 'q':	// --query-mode
+			try { QuerySocketMode = std::stoul(optarg, nullptr, 8) & 0777; }
+			catch (const std::invalid_argument& ia) { std::cerr << "Invalid argument: " << ia.what() << std::endl; exit(EXIT_FAILURE); }
+			catch (const std::out_of_range& oor) { std::cerr << "Out of Range error: " << oor.what() << std::endl; exit(EXIT_FAILURE); }
+			break;
+		case 'w':	// --http
+			HTTPListen = std::string(optarg);
+			break;
+		case 'P':	// --stats
+			try { PerfStatsMinutes = std::stoi(optarg); }
+			catch (const std::invalid_argument& ia) { std::cerr << "Invalid argument: " << ia.what() << std::endl; exit(EXIT_FAILURE); }
+			catch (const std::out_of_range& oor) { std::cerr << "Out of Range error: " << oor.what() << std::endl; exit(EXIT_FAILURE); }
+			break;
+		case 'g':	// --gzip
+			SVGGzip = true;
+			break;
+		case 'J':	// --json
+			JSONExport = true;
+			break;
+		case 'V':	// --variant
+			SVGVariantSpecs.push_back(std::string(optarg));
+			break;
+		case 'j':	// --svg-threads
+			try { SVGThreads = std::min(std::max(std::stoi(optarg), 0), 16); }
+			catch (const std::invalid_argument& ia) { std::cerr << "Invalid argument: " << ia.what() << std::endl; exit(EXIT_FAILURE); }
+			catch (const std::out_of_range& oor) { std::cerr << "Out of Range error: " << oor.what() << std::endl; exit(EXIT_FAILURE); }
+			break;
 		default:
 			usage(argc, argv);
 			exit(EXIT_FAILURE);
 		}
 	}
+	SVGVariant DefaultVariant;
+	DefaultVariant.Fahrenheit = SVGFahrenheit;
+	DefaultVariant.Battery = SVGBattery;
+	DefaultVariant.MinMax = SVGMinMax;
+	SVGVariants.push_back(DefaultVariant);
+	for (auto const& Spec : SVGVariantSpecs)
+	{
+		SVGVariant Variant(DefaultVariant);
+		auto Existing = SVGVariants.begin();	// left pointing at the first variant when the spec can't be read
+		if (ParseSVGVariant(Spec, Variant))
+			while ((Existing != SVGVariants.end()) && (Existing->Name != Variant.Name))
+				Existing++;
+		if (Existing != SVGVariants.end())
+		{
+			std::cerr << "Invalid argument: --variant " << Spec << std::endl;
+			exit(EXIT_FAILURE);
+		}
+		SVGVariants.push_back(Variant);
+	}
 	///////////////////////////////////////////////////////////////////////////////////////////////
 	if (!MRTGAddress.empty())
 	{
-		GetMRTGOutput(MRTGAddress, MinutesAverage);
+		if (QuerySocketPath.empty() || !QueryRunningLogger(MRTGAddress, MinutesAverage))
+			GetMRTGOutput(MRTGAddress, MinutesAverage);
 		exit(EXIT_SUCCESS);
 	}
 	///////////////////////////////////////////////////////////////////////////////////////////////
@@ -7431,6 +10506,17 @@ int main(int argc, char **argv)
 			std::cout << "[                   ]  passive: " << std::boolalpha << bUse_HCI_Passive << std::endl;
 			std::cout << "[                   ] no-bluetooth: " << std::boolalpha << !UseBluetooth << std::endl;
 			std::cout << "[                   ]      HCI: " << std::boolalpha << bUse_HCI_Interface << std::endl;
+			std::cout << "[                   ] compress: " << std::boolalpha << CompressLogs << std::endl;
+			std::cout << "[                   ] durability: " << LogDurability << std::endl;
+			std::cout << "[                   ]    stage: " << StagingMinutes << " minutes, " << StagingKiloBytes << " KB" << std::endl;
+			std::cout << "[                   ] query-socket: " << QuerySocketPath << " (mode " << std::oct << QuerySocketMode << std::dec << ")" << std::endl;
+			std::cout << "[                   ]     http: " << HTTPListen << std::endl;
+			std::cout << "[                   ]    stats: " << PerfStatsMinutes << " minutes" << std::endl;
+			std::cout << "[                   ] svg-threads: " << SVGThreads << std::endl;
+			std::cout << "[                   ]     gzip: " << std::boolalpha << SVGGzip << std::endl;
+			std::cout << "[                   ]     json: " << std::boolalpha << JSONExport << std::endl;
+			for (auto index = std::size_t(1); index < SVGVariants.size(); index++)
+				std::cout << "[                   ]  variant: " << SVGVariants[index].Name << " " << (SVGVariants[index].Fahrenheit ? "fahrenheit" : "celsius") << " battery " << SVGVariants[index].Battery << " minmax " << SVGVariants[index].MinMax << " " << SVGVariants[index].Width << "x" << SVGVariants[index].Height << std::endl;
 		}
 		if (!BT_WhiteList.empty())
 		{
@@ -7444,6 +10530,7 @@ int main(int argc, char **argv)
 		std::cerr << ProgramVersionString << " (starting)" << std::endl;
 	///////////////////////////////////////////////////////////////////////////////////////////////
 	tzset();
+	time(&LoggerStats.Started);
 	///////////////////////////////////////////////////////////////////////////////////////////////
 	if (!SVGDirectory.empty())
 	{
@@ -7451,10 +10538,15 @@ int main(int argc, char **argv)
 			SVGTitleMapFilename = std::filesystem::path(SVGDirectory / "gvh-titlemap.txt");
 		ReadTitleMap(SVGTitleMapFilename);
 	}
+	else if (!SVGTitleMapFilename.empty())
+		ReadTitleMap(SVGTitleMapFilename);
 	ReadPersistenceFile(GoveeThermometers, GoveeDevices);
+	OpenQuerySocket();
+	OpenHTTPSocket();
+	StartSVGWorkers();
 	if (UseBluetooth)
 	{
-		if (!SVGDirectory.empty())
+		if ((!SVGDirectory.empty()) || (!HTTPListen.empty()))
 		{
 			ReadCacheDirectory(); // if cache directory is configured, read it before reading all the normal logs
 			ReadLoggedData(); // only read the logged data if creating SVG files
@@ -7471,6 +10563,10 @@ int main(int argc, char **argv)
 		typedef void(*SignalHandlerPointer)(int);
 		SignalHandlerPointer previousHandlerSIGINT = std::signal(SIGINT, SignalHandlerSIGINT);	// Install CTR-C signal handler
 		SignalHandlerPointer previousHandlerSIGHUP = std::signal(SIGHUP, SignalHandlerSIGHUP);	// Install Hangup signal handler
+		SignalHandlerPointer previousHandlerSIGUSR1 = std::signal(SIGUSR1, SignalHandlerSIGUSR1);	// Install performance statistics signal handler
+#ifdef _TRACE_
+		SignalHandlerPointer previousHandlerSIGUSR2 = std::signal(SIGUSR2, SignalHandlerSIGUSR2);	// Install trace signal handler
+#endif // _TRACE_
 		///////////////////////////////////////////////////////////////////////////////////////////////
 		// I'm setting up the crypto environment at a wide scope only because I maight want to use the legacy code for the rc5 stuff when I clean up the functions.
 		// I didn't need to use the OSSL_PROVIDER_load(NULL, "default"); and OSSL_PROVIDER_load(NULL, "legacy"); calls at all if I only want to use the AES code from openssl
@@ -7489,18 +10585,22 @@ int main(int argc, char **argv)
 		OSSL_PROVIDER_unload(legacy);
 		OSSL_PROVIDER_unload(defaultp);
 		///////////////////////////////////////////////////////////////////////////////////////////////
+#ifdef _TRACE_
+		std::signal(SIGUSR2, previousHandlerSIGUSR2);	// Restore original trace signal handler
+#endif // _TRACE_
+		std::signal(SIGUSR1, previousHandlerSIGUSR1);	// Restore original performance statistics signal handler
 		std::signal(SIGHUP, previousHandlerSIGHUP);	// Restore original Hangup signal handler
 		std::signal(SIGINT, previousHandlerSIGINT);	// Restore original Ctrl-C signal handler
 		///////////////////////////////////////////////////////////////////////////////////////////////
 	}
-	else if ((!UseBluetooth) && (!LogDirectory.empty()) && (!SVGDirectory.empty()))
+	else if ((!UseBluetooth) && (!LogDirectory.empty()) && ((!SVGDirectory.empty()) || (!HTTPListen.empty())))
 	{
 		if (ConsoleVerbosity > 0)
 			std::cout << "[" << getTimeISO8601(true) << "] " << ProgramVersionString << " Running in --no-bluetooth mode" << std::endl;
 		else
 			std::cerr << ProgramVersionString << " Running in --no-bluetooth mode" << std::endl;
 
-		if (SVGTitleMapFilename.empty()) // If this wasn't set as a parameter, look in the SVG Directory for a default titlemap
+		if (SVGTitleMapFilename.empty() && !SVGDirectory.empty()) // If this wasn't set as a parameter, look in the SVG Directory for a default titlemap
 		{
 			std::ostringstream TitleMapFilename;
 			TitleMapFilename << SVGDirectory;
@@ -7514,32 +10614,58 @@ int main(int argc, char **argv)
 		auto previousHandlerSIGINT = std::signal(SIGINT, SignalHandlerSIGINT);	// Install CTR-C signal handler
 		auto previousHandlerSIGHUP = std::signal(SIGHUP, SignalHandlerSIGHUP);	// Install Hangup signal handler
 		auto previousAlarmHandler = std::signal(SIGALRM, SignalHandlerSIGALRM);	// Install Alarm signal handler
+		auto previousHandlerSIGUSR1 = std::signal(SIGUSR1, SignalHandlerSIGUSR1);	// Install performance statistics signal handler
+#ifdef _TRACE_
+		auto previousHandlerSIGUSR2 = std::signal(SIGUSR2, SignalHandlerSIGUSR2);	// Install trace signal handler
+#endif // _TRACE_
 		bRun = true;
+		MonitorLogDirectory();	// returns immediately if inotify isn't available, leaving the polling loop below as the fallback
+		// The signals are only let through while pselect waits, so one arriving between checks of bRun still ends the wait at once.
+		sigset_t set, OldMask;
+		sigemptyset(&set);
+		sigaddset(&set, SIGALRM);
+		sigaddset(&set, SIGINT);
+		sigaddset(&set, SIGHUP);
+		sigaddset(&set, SIGUSR1);
+#ifdef _TRACE_
+		sigaddset(&set, SIGUSR2);
+#endif // _TRACE_
+		sigprocmask(SIG_BLOCK, &set, &OldMask);
+		time_t NextPoll = time(NULL) + 5 * 60;
 		while (bRun)
 		{
-			sigset_t set;
-			sigemptyset(&set);
-			sigaddset(&set, SIGALRM);
-			sigaddset(&set, SIGINT);
-			sigaddset(&set, SIGHUP);
-			alarm(5 * 60);
-			if (ConsoleVerbosity > 0)
-				std::cout << "[" << getTimeISO8601(true) << "] Alarm Set" << std::endl;
-			int sig = 0;
-			sigwait(&set, &sig);
-			if (sig == SIGALRM)
+			// The query and HTTP clients are served while waiting for the next poll of the log directory
+			const time_t TimeNow(time(NULL));
+			const bool bClients = !QueryConnections.empty() || !HTTPConnections.empty();
+			struct timespec select_timeout = { bClients ? 1 : std::max(NextPoll - TimeNow, time_t(0)), 0 };	// seconds, nanoseconds
+			fd_set check_set, write_set;
+			FD_ZERO(&check_set);
+			FD_ZERO(&write_set);
+			pselect(AddServerSockets(check_set, write_set, -1) + 1, &check_set, &write_set, NULL, &select_timeout, &OldMask);	// returns -1 when interrupted by a signal
+			ServiceServerSockets();
+			ReportPerfStatistics();
+			if (bRun && (time(NULL) >= NextPoll))
 			{
 				if (ConsoleVerbosity > 0)
-					std::cout << "[" << getTimeISO8601(true) << "] Alarm Recieved" << std::endl;
+					std::cout << "[" << getTimeISO8601(true) << "] Polling: " << LogDirectory << std::endl;
 				MonitorLoggedData(LogFileTime * 2);
 				WriteAllSVG(GoveeMRTGLogs);
 				WriteAllSVG(RuuviMRTGLogs);
+				NextPoll = time(NULL) + 5 * 60;
 			}
 		}
+		sigprocmask(SIG_SETMASK, &OldMask, NULL);
+#ifdef _TRACE_
+		std::signal(SIGUSR2, previousHandlerSIGUSR2);	// Restore original trace signal handler
+#endif // _TRACE_
+		std::signal(SIGUSR1, previousHandlerSIGUSR1);	// Restore original performance statistics signal handler
 		std::signal(SIGALRM, previousAlarmHandler);	// Restore original Alarm signal handler
 		std::signal(SIGHUP, previousHandlerSIGHUP);	// Restore original Hangup signal handler
 		std::signal(SIGINT, previousHandlerSIGINT);	// Restore original Ctrl-C signal handler
 	}
+	StopSVGWorkers();
+	CloseHTTPSocket();
+	CloseQuerySocket();
 	///////////////////////////////////////////////////////////////////////////////////////////////
 	std::cerr << ProgramVersionString << " (exiting)" << std::endl;
 	return(ExitValue);
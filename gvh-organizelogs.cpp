@@ -52,6 +52,7 @@
 #include <sys/types.h>
 #include <unistd.h> // For close()
 #include <utime.h>
+#include <zlib.h> // sudo apt install zlib1g-dev
 #include "wimiso8601.h"
 #if !defined(__GLIBC__)
     #define stat64 stat
@@ -223,6 +224,37 @@ std::filesystem::path GenerateLogFileName(const bdaddr_t& a, time_t timer = 0)
 	std::filesystem::path NewFormatFileName(LogDirectory / OutputFilename.str());
 	return(NewFormatFileName);
 }
+// goveebttemplogger keeps an hourly offset index (gvh-XXXXXXXXXXXX-YYYY-MM.idx) beside each log file it writes, so that it can reload a log file it's monitoring
+// from a given hour. Rewriting a log file leaves its index pointing at the wrong lines, so it's removed, and the logger rebuilds it the next time it appends to the log.
+void RemoveLogIndex(const std::filesystem::path& LogFileName)
+{
+	std::error_code ec;
+	std::filesystem::remove(std::filesystem::path(LogFileName).replace_extension(".idx"), ec);
+}
+/////////////////////////////////////////////////////////////////////////////
+// Reads an entire log file into memory. gzread passes uncompressed files through unchanged, so this reads both
+// the plain .txt logs and the .txt.gz logs of completed months written by goveebttemplogger --compress.
+bool ReadLogFile(const std::filesystem::path& FileName, std::string& TheContents)
+{
+	bool rval = false;
+	gzFile TheFile = gzopen(FileName.c_str(), "rb");
+	if (TheFile != NULL)
+	{
+		gzbuffer(TheFile, 128 * 1024);
+		char buf[64 * 1024];
+		int bufDataLen;
+		while ((bufDataLen = gzread(TheFile, buf, sizeof(buf))) > 0)
+			TheContents.append(buf, bufDataLen);
+		rval = (bufDataLen == 0);
+		if (!rval)
+		{
+			int errnum = Z_OK;
+			std::cerr << " Error reading " << FileName << " " << gzerror(TheFile, &errnum) << std::endl;
+		}
+		gzclose(TheFile);
+	}
+	return(rval);
+}
 /////////////////////////////////////////////////////////////////////////////
 static void usage(int argc, char** argv)
 {
@@ -304,7 +336,7 @@ int main(int argc, char** argv)
 	{
 		std::cout << "[" << getTimeISO8601() << "] Merging contents of: " << MergeDirectory << " into " << LogDirectory << std::endl;
 		// Merging contents of MergeDirectory into LogDirectory.
-		const std::regex LogFileRegex("(gvh507x_|gvh-)[[:xdigit:]]{12}-[[:digit:]]{4}-[[:digit:]]{2}.txt"); // 2024-10-01 Both old and new format recognized
+		const std::regex LogFileRegex("(gvh507x_|gvh-)[[:xdigit:]]{12}-[[:digit:]]{4}-[[:digit:]]{2}.txt(.gz)?"); // 2024-10-01 Both old and new format recognized
 		std::deque<std::filesystem::path> files;
 		for (auto const& dir_entry : std::filesystem::directory_iterator{ MergeDirectory })
 			if (dir_entry.is_regular_file())
@@ -317,9 +349,10 @@ int main(int argc, char** argv)
 			while (!files.empty())
 			{
 				std::filesystem::path FQFileName(*files.begin());
-				std::ifstream TheFile(FQFileName);
-				if (TheFile.is_open())
+				std::string TheContents;
+				if (ReadLogFile(FQFileName, TheContents))
 				{
+					std::istringstream TheFile(TheContents);
 					std::deque<std::string> DataLines;
 					std::cout << "[" << getTimeISO8601() << "] Reading: " << FQFileName;
 					const std::regex ModifiedBluetoothAddressRegex("[[:xdigit:]]{12}");
@@ -340,7 +373,6 @@ int main(int argc, char** argv)
 							count++;
 						}
 						std::cout << " (" << count << " lines)" << std::endl;
-						TheFile.close();
 
 						// Sort all Data
 						sort(DataLines.begin(), DataLines.end());
@@ -370,6 +402,7 @@ int main(int argc, char** argv)
 												LogFile.close();
 											}
 											LastFileName = GenerateLogFileName(TheBlueToothAddress, TheTime);
+											RemoveLogIndex(LastFileName);
 											LogFile.open(LastFileName, std::ios_base::out | std::ios_base::app);
 											std::cout << "[" << getTimeISO8601() << "] Writing: " << LastFileName;
 											count = 0;
@@ -397,7 +430,7 @@ int main(int argc, char** argv)
 		std::cout << "[" << getTimeISO8601() << "] Organizing contents of: " << LogDirectory << std::endl;
 		std::cout << "[" << getTimeISO8601() << "]  Using BackupDirectory: " << BackupDirectory << std::endl;
 
-		const std::regex LogFileRegex("(gvh507x_|gvh-)[[:xdigit:]]{12}-[[:digit:]]{4}-[[:digit:]]{2}.txt"); // 2024-10-01 Both old and new format recognized
+		const std::regex LogFileRegex("(gvh507x_|gvh-)[[:xdigit:]]{12}-[[:digit:]]{4}-[[:digit:]]{2}.txt(.gz)?"); // 2024-10-01 Both old and new format recognized
 		std::deque<std::filesystem::path> files;
 		for (auto const& dir_entry : std::filesystem::directory_iterator{ LogDirectory })
 			if (dir_entry.is_regular_file())
@@ -413,9 +446,10 @@ int main(int argc, char** argv)
 				std::filesystem::path FQFileName(*files.begin());
 				std::filesystem::path BackupName(BackupDirectory / FQFileName.filename());
 				BackupName.replace_extension(FQFileName.extension());
-				std::ifstream TheFile(FQFileName);
-				if (TheFile.is_open())
+				std::string TheContents;
+				if (ReadLogFile(FQFileName, TheContents))
 				{
+					std::istringstream TheFile(TheContents);
 					std::deque<std::string> DataLines;
 					std::cout << "[" << getTimeISO8601() << "] Reading: " << FQFileName;
 					const std::regex ModifiedBluetoothAddressRegex("[[:xdigit:]]{12}");
@@ -436,7 +470,6 @@ int main(int argc, char** argv)
 							count++;
 						}
 						std::cout << " (" << count << " lines)";
-						TheFile.close();
 						// Rename Existing Log to backup.
 						bool bBackedUp = false;
 						try
@@ -488,6 +521,7 @@ int main(int argc, char** argv)
 													}
 												}
 												LastFileName = GenerateLogFileName(TheBlueToothAddress, TheTime);
+												RemoveLogIndex(LastFileName);
 												LogFile.open(LastFileName, std::ios_base::out | std::ios_base::app);
 												std::cout << "[" << getTimeISO8601() << "] Writing: " << LastFileName;
 												count = 0;
@@ -0,0 +1,152 @@
+/////////////////////////////////////////////////////////////////////////////
+// Checks that the SVG files, log lines and cache lines goveebttemplogger writes are byte for byte the same as the files in test/golden,
+// which were written by the std::ostream formatting used before SVG and log text was formatted with std::to_chars.
+// CMake builds it twice, once as golden-output with std::to_chars and once as golden-output-snprintf with the fallback older compilers get.
+//
+// golden-output directory			compares what's written with the files in directory
+// golden-output --write directory	writes the files to directory
+/////////////////////////////////////////////////////////////////////////////
+#ifdef GOLDEN_SNPRINTF
+#include <charconv>
+#undef __cpp_lib_to_chars	// as if the standard library only had to_chars for integers
+#endif // GOLDEN_SNPRINTF
+#define main goveebttemplogger_main
+#include "../goveebttemplogger.cpp"
+#undef main
+
+// A value that rises and falls linearly between Low and High over Period steps. Integer arithmetic, so the data is the same on every platform.
+int Triangle(const int Step, const int Period, const int Low, const int High)
+{
+	const int Phase(Step % Period);
+	const int Half(Period / 2);
+	return(Low + ((Phase < Half ? Phase : Period - Phase) * (High - Low)) / Half);
+}
+template <typename T> std::string GetSVG(const std::vector<T>& MRTG, const GraphType graph, const std::string& Title, const bool Fahrenheit, const bool DrawBattery, const bool MinMax)
+{
+	SVGVariant Variant;
+	Variant.Fahrenheit = Fahrenheit;
+	Variant.Battery = DrawBattery ? 0x0F : 0;
+	Variant.MinMax = MinMax ? 0x0F : 0;
+	const MRTGTier<T> TheValues(MRTG, graph);
+	SVGRanges Ranges;
+	FormatBuffer SVGFile(SVG_RESERVE);
+	WriteSVG(TheValues, Ranges, SVGFile, Title, graph, Variant);
+	// The comment naming the version and build time is the only line that depends on the build, so it's left out
+	std::string SVG(SVGFile.str());
+	const auto CommentStart(SVG.find("\t<!-- Created by:"));
+	if (CommentStart != std::string::npos)
+		SVG.erase(CommentStart, SVG.find('\n', CommentStart) + 1 - CommentStart);
+	return(SVG);
+}
+// Fills the graph data from readings at fixed times, and returns every file the check compares by name.
+std::map<std::string, std::string> GetGoldenFiles(void)
+{
+	std::map<std::string, std::string> Files;
+	const time_t Start(1700006400);	// 2023-11-15 00:00:00 UTC, so the graphs don't depend on when the check runs
+	const bdaddr_t GoveeAddress(string2ba("A4:C1:38:00:00:01"));
+	const bdaddr_t RuuviAddress(string2ba("C1:23:45:67:89:AB"));
+	std::string LogLines;
+	// 400 days of a thermometer every five minutes, enough to fill the yearly graph
+	for (auto Step = 0; Step < 400 * 24 * 12; Step++)
+	{
+		const double Temperature(Triangle(Step, 288, -57, 283) / 10.0 + Triangle(Step, 288 * 90, 0, 97) / 10.0);
+		const double Humidity(Triangle(Step + 77, 288, 315, 689) / 10.0);
+		const int Battery(100 - Step / 1500);
+		Govee_Temp TheValue(Start + Step * 300, Temperature, Humidity, Battery);
+		TheValue.SetModel(ThermometerType::H5075);
+		UpdateMRTGData(GoveeAddress, TheValue, GoveeMRTGLogs);
+		if (Step % 97 == 0)
+			LogLines += TheValue.WriteTXT() + "\n";
+	}
+	// 40 days of a RuuviTag every five minutes
+	for (auto Step = 0; Step < 40 * 24 * 12; Step++)
+	{
+		std::ostringstream TheLine;
+		TheLine << timeToExcelDate(Start + Step * 300);
+		TheLine << "\t" << std::to_string(Triangle(Step, 288, 1650, 2475) / 100.0);
+		TheLine << "\t" << std::to_string(Triangle(Step + 31, 288, 38125, 61875) / 1000.0);
+		TheLine << "\t" << std::to_string(Triangle(Step, 288 * 3, 98950, 102675) / 100.0);
+		TheLine << "\t" << std::to_string(3.1 - (Step / 288) / 1000.0);
+		TheLine << "\t4\t-0.012\t0.004\t1.016\t" << Step % 256 << "\t" << Step << "\t" << ba2string(RuuviAddress);
+		Ruuvi_Tag TheValue(TheLine.str());
+		UpdateMRTGData(RuuviAddress, TheValue, RuuviMRTGLogs);
+		if (Step % 97 == 0)
+			LogLines += TheValue.WriteTXT() + "\n";
+	}
+	// Models logging more than one temperature, with values that need exponents and rounding
+	const char* ProbeLines[] = {
+		"2024-01-02 03:04:05\t21.5\t0\t100\t5181\t63.0625",
+		"2024-01-02 03:04:05\t-3.125\t0\t87\t5182\t0.0001234\t1234567\t-0.00001",
+		"2024-01-02 03:04:05\t100.25\t0\t5\t5183\t999999.5",
+		"2024-01-02 03:04:05\t0.1\t0\t64\t5184\t0.2\t0.30000000000000004\t1e+100",
+		"2024-01-02 03:04:05\t37.77777777\t0\t99\t5055\t-40\t212\t1e-300",
+	};
+	for (auto const& ProbeLine : ProbeLines)
+		LogLines += Govee_Temp(std::string(ProbeLine)).WriteTXT() + "\n";
+	Files["log.txt"] = LogLines;
+	std::string CacheLines;
+	const std::vector<Govee_Temp>& GoveeMRTG(GoveeMRTGLogs[GoveeAddress]);
+	for (auto index = std::size_t(0); index < GoveeMRTG.size(); index += 7)
+		CacheLines += GoveeMRTG[index].WriteCache() + "\n";
+	const std::vector<Ruuvi_Tag>& RuuviMRTG(RuuviMRTGLogs[RuuviAddress]);
+	for (auto index = std::size_t(0); index < RuuviMRTG.size(); index += 7)
+		CacheLines += RuuviMRTG[index].WriteCache() + "\n";
+	Files["cache.txt"] = CacheLines;
+	Files["gvh-day.svg"] = GetSVG(GoveeMRTG, GraphType::daily, "Golden", true, true, true);
+	Files["gvh-week.svg"] = GetSVG(GoveeMRTG, GraphType::weekly, "Golden", true, true, true);
+	Files["gvh-month.svg"] = GetSVG(GoveeMRTG, GraphType::monthly, "Golden", true, true, true);
+	Files["gvh-year.svg"] = GetSVG(GoveeMRTG, GraphType::yearly, "Golden", true, true, true);
+	Files["gvh-celsius-day.svg"] = GetSVG(GoveeMRTG, GraphType::daily, "Golden Celsius", false, false, false);
+	Files["ruuvi-day.svg"] = GetSVG(RuuviMRTG, GraphType::daily, "Golden Ruuvi", false, true, true);
+	Files["ruuvi-month.svg"] = GetSVG(RuuviMRTG, GraphType::monthly, "Golden Ruuvi", true, false, true);
+	return(Files);
+}
+int main(int argc, char** argv)
+{
+	int rval = EXIT_SUCCESS;
+	setenv("TZ", "UTC0", 1);	// the graphs are labeled in local time
+	tzset();
+	const bool bWrite((argc == 3) && (std::string(argv[1]) == "--write"));
+	if ((argc != 2) && !bWrite)
+	{
+		std::cerr << "Usage: " << argv[0] << " [--write] directory" << std::endl;
+		rval = EXIT_FAILURE;
+	}
+	else
+	{
+		const std::filesystem::path GoldenDirectory(argv[argc - 1]);
+		for (auto const& [FileName, Contents] : GetGoldenFiles())
+		{
+			if (bWrite)
+			{
+				std::ofstream GoldenFile(GoldenDirectory / FileName, std::ios_base::out | std::ios_base::binary | std::ios_base::trunc);
+				GoldenFile << Contents;
+				std::cout << "Writing: " << (GoldenDirectory / FileName).string() << " (" << Contents.size() << " bytes)" << std::endl;
+			}
+			else
+			{
+				std::ifstream GoldenFile(GoldenDirectory / FileName, std::ios_base::in | std::ios_base::binary);
+				const std::string Golden((std::istreambuf_iterator<char>(GoldenFile)), std::istreambuf_iterator<char>());
+				if (!GoldenFile.is_open())
+				{
+					std::cerr << "Error: Unable to read " << (GoldenDirectory / FileName).string() << std::endl;
+					rval = EXIT_FAILURE;
+				}
+				else if (Golden != Contents)
+				{
+					auto Mismatch = std::mismatch(Golden.begin(), Golden.end(), Contents.begin(), Contents.end());
+					const auto Offset(std::distance(Golden.begin(), Mismatch.first));
+					const auto LineEnd(Golden.rfind('\n', Offset > 0 ? Offset - 1 : 0));
+					const auto LineStart((Offset == 0) || (LineEnd == std::string::npos) ? 0 : LineEnd + 1);
+					std::cerr << "Error: " << FileName << " differs at byte " << Offset << std::endl;
+					std::cerr << "  expected: " << Golden.substr(LineStart, Golden.find('\n', Offset) - LineStart) << std::endl;
+					std::cerr << "  written:  " << Contents.substr(LineStart, Contents.find('\n', Offset) - LineStart) << std::endl;
+					rval = EXIT_FAILURE;
+				}
+				else
+					std::cout << FileName << ": same (" << Contents.size() << " bytes)" << std::endl;
+			}
+		}
+	}
+	return(rval);
+}
@@ -11,14 +11,14 @@ std::string timeToISO8601(const time_t& TheTime, const bool LocalTime)
 	struct tm UTC;
 	struct tm* timecallresult(nullptr);
 	if (LocalTime)
-#ifdef localtime_r
+#ifndef _MSC_VER	// the reentrant versions, so the SVG worker threads can format times too
 		timecallresult = localtime_r(&TheTime, &UTC);
 #else
 		#pragma warning(suppress : 4996)
 		timecallresult = localtime(&TheTime);
 #endif
 	else
-#ifdef gmtime_r
+#ifndef _MSC_VER
 		timecallresult = gmtime_r(&TheTime, &UTC);
 #else
 		#pragma warning(suppress : 4996)
@@ -26,9 +26,9 @@ std::string timeToISO8601(const time_t& TheTime, const bool LocalTime)
 #endif
 	if (nullptr != timecallresult)
 	{
-#ifndef gmtime_r
+#ifdef _MSC_VER
 		UTC = *timecallresult;
-#endif // !gmtime_r
+#endif // _MSC_VER
 
 		ISOTime.fill('0');
 		if (!((UTC.tm_year == 70) && (UTC.tm_mon == 0) && (UTC.tm_mday == 1)))